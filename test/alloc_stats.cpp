@@ -0,0 +1,86 @@
+#include <cstdlib>
+#include <new>
+
+#include "alloc_stats.h"
+
+namespace {
+
+void* counted_alloc(std::size_t n)
+{
+	auto& c = alloc_stats::this_thread();
+	++c.allocs;
+	c.bytes += n;
+
+	return std::malloc(n ? n : 1);
+}
+
+void* counted_alloc(std::size_t n, std::align_val_t al)
+{
+	auto& c = alloc_stats::this_thread();
+	++c.allocs;
+	c.bytes += n;
+
+	// aligned_alloc wants the size to be a multiple of the alignment
+	auto a = static_cast<std::size_t>(al);
+	return std::aligned_alloc(a, (n + a - 1) / a * a);
+}
+
+void counted_free(void *p)
+{
+	if (!p)
+		return;
+
+	++alloc_stats::this_thread().frees;
+	std::free(p);
+}
+
+}
+
+void* operator new(std::size_t n)
+{
+	if (void *p = counted_alloc(n))
+		return p;
+	throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t n)
+{
+	if (void *p = counted_alloc(n))
+		return p;
+	throw std::bad_alloc{};
+}
+
+void* operator new(std::size_t n, std::align_val_t al)
+{
+	if (void *p = counted_alloc(n, al))
+		return p;
+	throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t n, std::align_val_t al)
+{
+	if (void *p = counted_alloc(n, al))
+		return p;
+	throw std::bad_alloc{};
+}
+
+void* operator new(std::size_t n, std::nothrow_t const&) noexcept
+{
+	return counted_alloc(n);
+}
+
+void* operator new[](std::size_t n, std::nothrow_t const&) noexcept
+{
+	return counted_alloc(n);
+}
+
+void operator delete(void *p) noexcept { counted_free(p); }
+void operator delete[](void *p) noexcept { counted_free(p); }
+void operator delete(void *p, std::size_t) noexcept { counted_free(p); }
+void operator delete[](void *p, std::size_t) noexcept { counted_free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { counted_free(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { counted_free(p); }
+void operator delete(void *p, std::nothrow_t const&) noexcept { counted_free(p); }
+void operator delete[](void *p, std::nothrow_t const&) noexcept { counted_free(p); }
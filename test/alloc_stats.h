@@ -0,0 +1,57 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Heap allocation accounting.  Building with TETRIS_ALLOC_STATS defined
+// and alloc_stats.cpp linked in replaces the global operator new/delete
+// with versions that count into the calling thread's counters; without
+// it every count simply stays zero.
+namespace alloc_stats {
+
+#ifdef TETRIS_ALLOC_STATS
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+struct counters
+{
+	std::uint64_t allocs{0};
+	std::uint64_t frees{0};
+	std::uint64_t bytes{0};
+
+	counters operator-(counters const& rhs) const
+	{
+		return {allocs - rhs.allocs, frees - rhs.frees, bytes - rhs.bytes};
+	}
+
+	counters operator+(counters const& rhs) const
+	{
+		return {allocs + rhs.allocs, frees + rhs.frees, bytes + rhs.bytes};
+	}
+};
+
+inline counters& this_thread()
+{
+	static thread_local counters c;
+	return c;
+}
+
+// Allocations made on this thread since construction, e.g. during one
+// frame or one engine call.
+class scope
+{
+	counters start{this_thread()};
+
+public:
+	counters delta() const
+	{
+		return this_thread() - start;
+	}
+};
+
+}
+
+#endif // ALLOC_STATS_H
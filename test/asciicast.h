@@ -0,0 +1,451 @@
+#ifndef ASCIICAST_H
+#define ASCIICAST_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cerrno>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+// Recording of a program's terminal output as an asciicast v2 file, the
+// format asciinema plays back.
+//
+// session swaps stdio's stdout for a stream that still writes every
+// flushed buffer straight to the terminal, and then only copies it with
+// a timestamp into a lock-free ring.  A writer thread drains the ring
+// into the file and also notes terminal resizes.  So the UI thread never
+// waits on the disk; when the writer falls behind by a whole ring, the
+// chunks that do not fit are left out of the recording and counted.
+//
+// Output that bypasses stdio's stdout, e.g. a write() to the fd, is not
+// recorded.
+namespace asciicast {
+
+using clock = std::chrono::steady_clock;
+
+// Ring of timestamped byte chunks for one producer and one consumer
+class chunk_ring
+{
+public:
+	explicit chunk_ring(std::size_t capacity_log2 = 22)
+		: capacity(std::size_t(1) << capacity_log2)
+		, buf(new char[capacity])
+	{}
+
+	// Largest chunk push() takes
+	std::size_t max_chunk() const
+	{
+		return capacity / 4;
+	}
+
+	// More than half in use, on the producer's side
+	bool filling() const
+	{
+		auto used = head.load(std::memory_order_relaxed) - tail.load(std::memory_order_relaxed);
+		return used > capacity / 2;
+	}
+
+	// false, and nothing stored, when the chunk does not fit
+	bool push(std::uint64_t time_ns, char const *data, std::size_t n)
+	{
+		auto h = head.load(std::memory_order_relaxed);
+		auto need = sizeof(header) + n;
+
+		if (n > max_chunk() || need > capacity - (h - tail.load(std::memory_order_acquire)))
+			return false;
+
+		header hdr{time_ns, std::uint32_t(n), 0};
+		copy_in(h, &hdr, sizeof(hdr));
+		copy_in(h + sizeof(hdr), data, n);
+
+		head.store(h + need, std::memory_order_release);
+		return true;
+	}
+
+	// Hand every stored chunk to f(time_ns, data, size); returns their
+	// number
+	template <typename F>
+	std::size_t drain(F&& f)
+	{
+		auto t = tail.load(std::memory_order_relaxed);
+		auto h = head.load(std::memory_order_acquire);
+		std::size_t chunks = 0;
+
+		while(t < h) {
+			header hdr;
+			copy_out(t, &hdr, sizeof(hdr));
+			scratch.resize(hdr.size);
+			copy_out(t + sizeof(hdr), scratch.data(), hdr.size);
+
+			t += sizeof(hdr) + hdr.size;
+			tail.store(t, std::memory_order_release);
+
+			f(hdr.time_ns, scratch.data(), scratch.size());
+			++chunks;
+		}
+
+		return chunks;
+	}
+
+private:
+	struct header
+	{
+		std::uint64_t time_ns;
+		std::uint32_t size;
+		std::uint32_t reserved;
+	};
+
+	std::size_t capacity;
+	std::unique_ptr<char[]> buf;
+	std::vector<char> scratch;
+
+	alignas(64) std::atomic<std::uint64_t> head{0};
+	alignas(64) std::atomic<std::uint64_t> tail{0};
+
+	void copy_in(std::uint64_t pos, void const *src, std::size_t n)
+	{
+		auto off = pos & (capacity - 1);
+		auto first = std::min(n, capacity - off);
+		std::memcpy(buf.get() + off, src, first);
+		std::memcpy(buf.get(), static_cast<char const *>(src) + first, n - first);
+	}
+
+	void copy_out(std::uint64_t pos, void *dst, std::size_t n) const
+	{
+		auto off = pos & (capacity - 1);
+		auto first = std::min(n, capacity - off);
+		std::memcpy(dst, buf.get() + off, first);
+		std::memcpy(static_cast<char *>(dst) + first, buf.get(), n - first);
+	}
+};
+
+// Appends the JSON string of one event's UTF-8 text to out.  A sequence
+// cut off at the end of data is left in carry for the next chunk, bytes
+// that are not UTF-8 become U+FFFD.
+inline void append_json_text(std::string& out, std::string& carry,
+                             char const *data, std::size_t n)
+{
+	std::string text;
+	text.swap(carry);
+	text.append(data, n);
+
+	out += '"';
+
+	std::size_t i = 0;
+	while(i < text.size()) {
+		auto c = static_cast<unsigned char>(text[i]);
+
+		if (c < 0x80) {
+			switch(c) {
+			case '"':
+				out += "\\\"";
+				break;
+			case '\\':
+				out += "\\\\";
+				break;
+			case '\n':
+				out += "\\n";
+				break;
+			case '\r':
+				out += "\\r";
+				break;
+			default:
+				if (c < 0x20 || c == 0x7f) {
+					char esc[8];
+					std::snprintf(esc, sizeof(esc), "\\u%04x", c);
+					out += esc;
+				} else {
+					out += char(c);
+				}
+			}
+			++i;
+			continue;
+		}
+
+		std::size_t len = c >= 0xf0 && c < 0xf5 ? 4 : c >= 0xe0 ? 3 : c >= 0xc2 ? 2 : 0;
+		if (len == 0 || c >= 0xf5) {
+			out += "\\ufffd";
+			++i;
+			continue;
+		}
+
+		if (i + len > text.size()) {
+			// the rest comes with the next chunk, unless what is here
+			// is broken already
+			bool cont = true;
+			for(auto k = i + 1; k < text.size(); ++k)
+				cont = cont && (static_cast<unsigned char>(text[k]) & 0xc0) == 0x80;
+			if (cont) {
+				carry.assign(text, i, std::string::npos);
+				break;
+			}
+		}
+
+		bool valid = i + len <= text.size();
+		for(std::size_t k = 1; valid && k < len; ++k)
+			valid = (static_cast<unsigned char>(text[i + k]) & 0xc0) == 0x80;
+
+		if (valid) {
+			out.append(text, i, len);
+			i += len;
+		} else {
+			out += "\\ufffd";
+			++i;
+		}
+	}
+
+	out += '"';
+}
+
+class session
+{
+public:
+	// Record what goes to stdout from now on into path; the terminal
+	// size is taken from fd
+	explicit session(std::string const& path, int fd = STDOUT_FILENO)
+		: file_path(path)
+		, term_fd(fd)
+		, start(clock::now())
+	{
+		file = std::fopen(path.c_str(), "w");
+		if (!file)
+			return;
+
+		size = terminal_size();
+
+		std::string hdr = "{\"version\": 2, \"width\": " + std::to_string(size.first)
+		                + ", \"height\": " + std::to_string(size.second)
+		                + ", \"timestamp\": " + std::to_string(std::time(nullptr));
+
+		if (auto const *term = std::getenv("TERM")) {
+			std::string carry;
+			hdr += ", \"env\": {\"TERM\": ";
+			append_json_text(hdr, carry, term, std::strlen(term));
+			hdr += "}";
+		}
+		hdr += "}\n";
+		std::fputs(hdr.c_str(), file);
+
+		if (!tee())
+			return;
+
+		writer = std::thread([this] { run(); });
+	}
+
+	session(session const&) = delete;
+	session& operator=(session const&) = delete;
+
+	// Put stdout back and finish the file; after the program's last
+	// output, so declare the session before the application
+	~session()
+	{
+		if (original) {
+			std::fflush(stdout);
+			auto *teed = stdout;
+			stdout = original;
+			std::fclose(teed);
+		}
+
+		if (writer.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(m);
+				stopping = true;
+			}
+			wake.notify_one();
+			writer.join();
+		}
+
+		if (file)
+			std::fclose(file);
+	}
+
+	bool ok() const
+	{
+		return file && original && !failed.load(std::memory_order_relaxed);
+	}
+
+	std::string const& path() const
+	{
+		return file_path;
+	}
+
+	// Bytes written to the terminal that did not fit the ring
+	std::uint64_t dropped() const
+	{
+		return lost.load(std::memory_order_relaxed);
+	}
+
+	// Take bytes going to the terminal, on the thread writing them
+	void capture(char const *data, std::size_t n)
+	{
+		auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			clock::now() - start).count();
+
+		while(n > 0) {
+			auto part = std::min(n, ring.max_chunk());
+			if (!ring.push(ns, data, part))
+				lost.fetch_add(part, std::memory_order_relaxed);
+			data += part;
+			n -= part;
+		}
+
+		// wake the writer before its next round when the ring fills
+		// up; a wakeup lost to the race only costs the wait
+		if (ring.filling() && !nudged.exchange(true, std::memory_order_relaxed))
+			wake.notify_one();
+	}
+
+private:
+	std::string file_path;
+	int term_fd;
+	clock::time_point start;
+	std::FILE *file{nullptr};
+	std::FILE *original{nullptr};
+
+	chunk_ring ring;
+	std::atomic<std::uint64_t> lost{0};
+	std::atomic<bool> failed{false};
+
+	std::thread writer;
+	std::mutex m;
+	std::condition_variable wake;
+	bool stopping{false};
+	std::atomic<bool> nudged{false};
+
+	std::pair<unsigned, unsigned> size{80, 24};
+	std::uint64_t last_ns{0};
+	std::string line;
+	std::string carry;
+
+	std::pair<unsigned, unsigned> terminal_size() const
+	{
+		winsize ws{};
+		if (ioctl(term_fd, TIOCGWINSZ, &ws) == 0 && ws.ws_col && ws.ws_row)
+			return {ws.ws_col, ws.ws_row};
+		return size;
+	}
+
+	static ssize_t write_out(void *cookie, char const *data, std::size_t n)
+	{
+		auto *s = static_cast<session *>(cookie);
+
+		// the terminal first, as without recording
+		for(std::size_t done = 0; done < n; ) {
+			auto w = ::write(s->term_fd, data + done, n - done);
+			if (w < 0) {
+				if (errno == EINTR)
+					continue;
+				return done ? ssize_t(done) : -1;
+			}
+			done += w;
+		}
+
+		s->capture(data, n);
+		return n;
+	}
+
+	bool tee()
+	{
+		cookie_io_functions_t io{};
+		io.write = write_out;
+
+		auto *teed = fopencookie(this, "w", io);
+		if (!teed)
+			return false;
+
+		// as buffered as stdout was, so the terminal sees the same writes
+		std::fflush(stdout);
+		setvbuf(teed, nullptr, isatty(term_fd) ? _IOLBF : _IOFBF, BUFSIZ);
+		original = stdout;
+		stdout = teed;
+		return true;
+	}
+
+	void event(std::uint64_t ns, char kind, char const *data, std::size_t n)
+	{
+		// a resize is stamped when noticed, which may be after output
+		// still in the ring
+		ns = last_ns = std::max(ns, last_ns);
+
+		char stamp[48];
+		std::snprintf(stamp, sizeof(stamp), "[%.6f, \"%c\", ", ns / 1e9, kind);
+
+		line = stamp;
+		std::string none;
+		append_json_text(line, kind == 'o' ? carry : none, data, n);
+		line += "]\n";
+
+		if (std::fwrite(line.data(), 1, line.size(), file) != line.size())
+			failed.store(true, std::memory_order_relaxed);
+	}
+
+	void run()
+	{
+		for(;;) {
+			bool stop;
+			{
+				std::unique_lock<std::mutex> lock(m);
+				wake.wait_for(lock, std::chrono::milliseconds(20), [this] {
+					return stopping || nudged.load(std::memory_order_relaxed);
+				});
+				stop = stopping;
+			}
+			nudged.store(false, std::memory_order_relaxed);
+
+			auto now = terminal_size();
+			if (now != size) {
+				size = now;
+				auto s = std::to_string(size.first) + "x" + std::to_string(size.second);
+				auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+					clock::now() - start).count();
+				event(ns, 'r', s.data(), s.size());
+			}
+
+			auto chunks = ring.drain([this](std::uint64_t ns, char const *data, std::size_t n) {
+				event(ns, 'o', data, n);
+			});
+
+			if (chunks)
+				std::fflush(file);
+
+			if (stop)
+				break;
+		}
+	}
+};
+
+// The session --record FILE asks for, null without one.  The option is
+// taken out of argv, so call this before the application parses it,
+// which also has the session outlive the application as it should.  A
+// session that cannot write FILE is returned too, and not ok().
+inline std::unique_ptr<session> from_args(int& argc, char **argv)
+{
+	std::unique_ptr<session> s;
+
+	int out = 1;
+	for(int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+			s = std::make_unique<session>(argv[++i]);
+		else
+			argv[out++] = argv[i];
+	}
+	argc = out;
+
+	return s;
+}
+
+}
+
+#endif // ASCIICAST_H
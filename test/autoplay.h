@@ -0,0 +1,81 @@
+#ifndef AUTOPLAY_H
+#define AUTOPLAY_H
+
+#include <limits>
+
+#include "board_features.h"
+#include "movegen.h"
+#include "tetris_engine.h"
+
+namespace game {
+
+// Simple greedy bot: looks at every place the active piece can reach
+// (see movegen.h), and keeps the one whose board scores best on the
+// usual height/holes/bumpiness heuristic.
+inline double evaluate_board(bitboard const& b, int lines)
+{
+	float f[feature_count];
+	extract_features(b, f);
+
+	return -0.51 * f[f_aggregate_height] + 0.76 * lines
+	       - 0.36 * f[f_holes] - 0.18 * f[f_bumpiness];
+}
+
+inline double evaluate_board(engine const& eng, int lines)
+{
+	return evaluate_board(to_bitboard(eng, false), lines);
+}
+
+// Best landing of the last generate(), or nullptr if there is none
+inline landing const *best_landing(move_generator& gen, engine const& eng)
+{
+	landing const *best = nullptr;
+	double best_score = -std::numeric_limits<double>::infinity();
+
+	gen.generate(eng);
+
+	for(auto const& l : gen) {
+		bitboard b = gen.board();
+		gen.place(l, b);
+		int lines = clear_lines(b);
+
+		double score = evaluate_board(b, lines);
+		if (score > best_score) {
+			best = &l;
+			best_score = score;
+		}
+	}
+
+	return best;
+}
+
+// Plays one engine: a freshly spawned piece is moved to its best
+// landing in one go, after that it falls one row per step.
+class autoplayer
+{
+	move_generator gen;
+	bool placed{false};
+
+public:
+	cleared_rows step(engine& eng)
+	{
+		if (!eng.active_piece) {
+			eng.update();
+			placed = false;
+			return {};
+		}
+
+		if (!placed) {
+			if (auto best = best_landing(gen, eng))
+				gen.play(eng, *best);
+			placed = true;
+			return {};
+		}
+
+		return eng.update();
+	}
+};
+
+}
+
+#endif // AUTOPLAY_H
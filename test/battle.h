@@ -0,0 +1,339 @@
+#ifndef BATTLE_H
+#define BATTLE_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "autoplay.h"
+#include "tetris_engine.h"
+#include "worker_pool.h"
+
+namespace game {
+
+// Rows of garbage a clear of n lines sends
+inline std::size_t garbage_for(std::size_t lines)
+{
+	switch(lines) {
+	case 2:
+		return 1;
+	case 3:
+		return 2;
+	case 4:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+// Garbage sent to one player during a tick.  Any thread may push; the
+// owner drains it only after the tick barrier, so a slot index from one
+// atomic counter is all the synchronisation a push needs.  Packets are
+// applied in sender order, which keeps a battle deterministic whatever
+// order the threads pushed in.
+class garbage_inbox
+{
+public:
+	struct packet
+	{
+		std::uint16_t from;
+		std::uint8_t rows;
+		std::uint8_t hole;
+	};
+
+	static constexpr std::size_t capacity = 64;
+
+	// false if the inbox was full and the packet dropped
+	bool push(packet p)
+	{
+		auto i = count.fetch_add(1, std::memory_order_relaxed);
+		if (i >= capacity)
+			return false;
+
+		slots[i] = p;
+		return true;
+	}
+
+	template <typename F>
+	void drain(F&& f)
+	{
+		auto n = std::min<std::size_t>(count.load(std::memory_order_relaxed), capacity);
+		std::sort(slots.begin(), slots.begin() + n,
+		          [](packet const& a, packet const& b) { return a.from < b.from; });
+
+		for(std::size_t i = 0; i < n; ++i)
+			f(slots[i]);
+
+		count.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	std::array<packet, capacity> slots;
+	std::atomic<std::uint32_t> count{0};
+};
+
+// Barrier for a fixed set of threads that meet often, e.g. every tick:
+// the last one in releases the others, which spin briefly and then
+// yield.  It also orders everything written before it against everything
+// read after it.
+class spin_barrier
+{
+public:
+	explicit spin_barrier(std::size_t n)
+		: threads(n)
+	{}
+
+	void arrive_and_wait()
+	{
+		auto p = phase.load(std::memory_order_acquire);
+
+		if (waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == threads) {
+			waiting.store(0, std::memory_order_relaxed);
+			phase.fetch_add(1, std::memory_order_release);
+			return;
+		}
+
+		for(int spins = 0; phase.load(std::memory_order_acquire) == p; ++spins)
+			if (spins > 64)
+				std::this_thread::yield();
+	}
+
+private:
+	std::size_t threads;
+	std::atomic<std::size_t> waiting{0};
+	std::atomic<std::uint32_t> phase{0};
+};
+
+struct battle_options
+{
+	std::size_t players{2};
+	std::size_t width{10}, height{20};
+	std::uint32_t seed{1};
+	long max_ticks{20000};
+};
+
+// Versus game of two or more engines played by the greedy bot, in
+// lockstep: every player makes one autoplayer step per tick.  Lines a
+// player clears send garbage (see garbage_for()) to one opponent still
+// alive, taking turns among them; it arrives at the start of that
+// opponent's next tick, with the hole in a column the sender draws.
+//
+// Inboxes and the alive flags are double buffered by tick parity, so
+// within a tick players only write what nobody reads until the next
+// one, and the result does not depend on how players are spread over
+// threads.  run() with a pool steps each player's share on its own
+// thread and meets the others only at the barrier closing every tick.
+class battle
+{
+public:
+	struct player
+	{
+		engine eng;
+		autoplayer bot;
+		std::uint32_t rng;
+		std::size_t target;
+		garbage_inbox inbox[2];
+
+		int sent{0};
+		int received{0};
+		long died_at{-1};
+
+		player(battle_options const& o, std::size_t i)
+			: eng(o.width, o.height, o.seed)
+			, rng(o.seed * 2654435761u + i * 40503u + 1)
+			, target(i + 1)
+		{
+			eng.reset();
+		}
+	};
+
+	explicit battle(battle_options const& o)
+		: options(o)
+	{
+		options.players = std::max<std::size_t>(options.players, 2);
+
+		// every player gets the same pieces
+		for(std::size_t i = 0; i < options.players; ++i)
+			players.push_back(std::make_unique<player>(options, i));
+
+		for(auto& a : alive)
+			a.assign(options.players, 1);
+	}
+
+	std::size_t size() const
+	{
+		return players.size();
+	}
+
+	player& operator[](std::size_t i)
+	{
+		return *players[i];
+	}
+
+	player const& operator[](std::size_t i) const
+	{
+		return *players[i];
+	}
+
+	long ticks() const
+	{
+		return tick;
+	}
+
+	bool over() const
+	{
+		return finished(tick - 1);
+	}
+
+	// One tick of every player on the calling thread
+	void step()
+	{
+		if (over())
+			return;
+
+		for(std::size_t i = 0; i < players.size(); ++i)
+			step_player(i, tick);
+		++tick;
+	}
+
+	// Play to the end; with a pool, player i steps on worker
+	// i % pool->size()
+	void run(worker_pool *pool = nullptr)
+	{
+		if (!pool || pool->size() < 2) {
+			while(!over())
+				step();
+			return;
+		}
+
+		auto threads = std::min(pool->size(), players.size());
+		spin_barrier barrier(threads);
+		long first = tick;
+		std::atomic<long> last{first};
+
+		pool->run([&](std::size_t w) {
+			if (w >= threads)
+				return;
+
+			for(long t = first; !finished(t - 1); ++t) {
+				for(std::size_t i = w; i < players.size(); i += threads)
+					step_player(i, t);
+
+				barrier.arrive_and_wait();
+
+				if (w == 0)
+					last.store(t + 1, std::memory_order_relaxed);
+			}
+		});
+
+		tick = last.load();
+	}
+
+	// Index of the winner, -1 for a draw: the last one standing, or
+	// else whoever lasted longest and then scored most
+	int winner() const
+	{
+		int best = -1;
+		bool tie = false;
+
+		auto lasted = [&](player const& p) { return p.died_at < 0 ? tick : p.died_at; };
+
+		for(std::size_t i = 0; i < players.size(); ++i) {
+			auto const& p = *players[i];
+			if (best < 0) {
+				best = i;
+				continue;
+			}
+
+			auto const& b = *players[best];
+			if (lasted(p) > lasted(b)
+			    || (lasted(p) == lasted(b) && p.eng.score > b.eng.score)) {
+				best = i;
+				tie = false;
+			} else if (lasted(p) == lasted(b) && p.eng.score == b.eng.score) {
+				tie = true;
+			}
+		}
+
+		return tie ? -1 : best;
+	}
+
+private:
+	battle_options options;
+	std::vector<std::unique_ptr<player>> players;
+	std::vector<std::uint8_t> alive[2];
+	long tick{0};
+
+	// whether the battle ended with tick t
+	bool finished(long t) const
+	{
+		if (t < 0)
+			return false;
+		if (t + 1 >= options.max_ticks)
+			return true;
+
+		auto const& a = alive[t & 1];
+		return std::count(a.begin(), a.end(), 1) <= 1;
+	}
+
+	void step_player(std::size_t i, long t)
+	{
+		auto& p = *players[i];
+		auto const& was = alive[(t + 1) & 1];
+		auto& is = alive[t & 1];
+
+		if (!was[i]) {
+			is[i] = 0;
+			return;
+		}
+
+		// what arrived during the last tick
+		p.inbox[(t + 1) & 1].drain([&](garbage_inbox::packet const& g) {
+			p.eng.add_garbage(g.rows, g.hole);
+			p.received += g.rows;
+		});
+
+		auto cleared = p.eng.game_over ? cleared_rows{} : p.bot.step(p.eng);
+
+		if (auto rows = garbage_for(cleared.size())) {
+			auto to = next_target(p, i, was);
+			if (to != i) {
+				p.rng ^= p.rng << 13;
+				p.rng ^= p.rng >> 17;
+				p.rng ^= p.rng << 5;
+
+				garbage_inbox::packet g{std::uint16_t(i), std::uint8_t(rows),
+				                        std::uint8_t(p.rng % options.width)};
+				if (players[to]->inbox[t & 1].push(g))
+					p.sent += rows;
+			}
+		}
+
+		is[i] = !p.eng.game_over;
+		if (p.eng.game_over)
+			p.died_at = t;
+	}
+
+	// next opponent alive at the start of the tick, in turn
+	std::size_t next_target(player& p, std::size_t self,
+	                        std::vector<std::uint8_t> const& was)
+	{
+		for(std::size_t k = 0; k < players.size(); ++k) {
+			auto to = (p.target + k) % players.size();
+			if (to != self && was[to]) {
+				p.target = to + 1;
+				return to;
+			}
+		}
+
+		return self;
+	}
+};
+
+}
+
+#endif // BATTLE_H
@@ -0,0 +1,321 @@
+#ifndef BOARD_FEATURES_H
+#define BOARD_FEATURES_H
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "placement.h"
+#include "tetris_engine.h"
+
+// Heuristic board features for bots and training, on a bitboard layout.
+//
+// A bitboard (see placement.h) keeps one 32 bit mask per row.  Every
+// feature is computed with whole-row bit operations, so all columns of
+// a row are handled at once.  The batch version additionally runs 4
+// boards side by side in the lanes of a 128 bit GCC vector (SSE2 or
+// NEON), one board per lane.
+namespace game {
+
+enum feature
+{
+	f_aggregate_height,  // sum of column heights
+	f_holes,             // empty cells with a filled cell above
+	f_bumpiness,         // sum of height differences of neighbouring columns
+	f_wells,             // open empty cells with both neighbours filled
+	f_row_transitions,   // filled/empty changes along rows, walls filled
+	f_col_transitions,   // filled/empty changes down columns, floor filled
+	f_complete_lines,    // full rows
+	f_max_height,
+	feature_count
+};
+
+// The board as a bitboard.  Without with_active the cells of the active
+// piece, which the engine keeps on the board, are left out.  A board
+// larger than a bitboard holds comes out as an empty 0x0 one.
+inline bitboard to_bitboard(engine const& eng, bool with_active = true)
+{
+	bitboard b;
+	if (!bitboard::fits(eng.width, eng.height))
+		return b;
+
+	b.width = eng.width;
+	b.height = eng.height;
+
+	for(std::size_t y = 0; y < eng.height; ++y)
+		for(std::size_t x = 0; x < eng.width; ++x)
+			if (eng.board[y][x] != 0)
+				b.rows[y] |= 1u << x;
+
+	if (!with_active && eng.active_piece) {
+		auto& ap = *eng.active_piece;
+		auto clear = [&](int x, int y) {
+			if (x >= 0 && x < (int)b.width && y >= 0 && y < (int)b.height)
+				b.rows[y] &= ~(1u << x);
+		};
+
+		clear(ap.orig_x, ap.orig_y);
+		for(auto blk : ap.blocks)
+			clear(ap.orig_x + blk.first, ap.orig_y + blk.second);
+	}
+
+	return b;
+}
+
+// Drop full rows like engine::try_clear_lines(), returns their number
+inline int clear_lines(bitboard& b)
+{
+	std::uint32_t full = (1u << b.width) - 1;
+	int to = b.height - 1;
+
+	for(int y = b.height - 1; y >= 0; --y)
+		if (b.rows[y] != full)
+			b.rows[to--] = b.rows[y];
+
+	int cleared = to + 1;
+	for(; to >= 0; --to)
+		b.rows[to] = 0;
+
+	return cleared;
+}
+
+namespace detail {
+
+// Popcount, written with shifts and masks so the same code works on
+// scalars and on every lane of a vector.
+template <typename T>
+inline T popcount32(T x)
+{
+	x = x - ((x >> 1) & 0x55555555u);
+	x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+	x = (x + (x >> 4)) & 0x0f0f0f0fu;
+	x = x + (x >> 8);
+	return (x + (x >> 16)) & 0x3fu;
+}
+
+// Row features shared by the scalar and the vector code.  T is either
+// std::uint32_t or a vector of them; full has the low width bits set.
+template <typename T>
+struct accumulator
+{
+	T seen{}, prev{};
+	T height{}, holes{}, wells{}, row_trans{}, col_trans{}, lines{};
+
+	// bit sliced per-column height counters, enough for 32 rows
+	T planes[6]{};
+
+	void add_row(T r, T full, std::uint32_t width)
+	{
+		T left = (r << 1) | 1u;
+		T right = (r >> 1) | (1u << (width - 1));
+
+		holes += popcount32(seen & ~r & full);
+		wells += popcount32(~r & ~seen & left & right & full);
+
+		seen |= r;
+		height += popcount32(seen);
+
+		// walls on both sides count as filled
+		T ext = (r << 1) | 1u | (1u << (width + 1));
+		row_trans += popcount32((ext ^ (ext >> 1)) & ((full << 1) | 1u));
+
+		col_trans += popcount32(r ^ prev);
+		prev = r;
+
+		T carry = seen;
+		for(auto& p : planes) {
+			T c = p & carry;
+			p ^= carry;
+			carry = c;
+		}
+	}
+
+	T column_height(std::uint32_t x) const
+	{
+		T h{};
+		for(std::uint32_t k = 0; k < 6; ++k)
+			h |= ((planes[k] >> x) & 1u) << k;
+		return h;
+	}
+};
+
+}
+
+// Features of one board into out[0 .. feature_count)
+inline void extract_features(bitboard const& b, float *out)
+{
+	std::uint32_t full = (1u << b.width) - 1;
+	detail::accumulator<std::uint32_t> acc;
+	std::uint32_t lines = 0;
+
+	for(std::size_t y = 0; y < b.height; ++y) {
+		acc.add_row(b.rows[y], full, b.width);
+		lines += b.rows[y] == full;
+	}
+
+	// the floor counts as filled
+	acc.col_trans += detail::popcount32(acc.prev ^ full);
+
+	std::uint32_t bump = 0, max_height = 0;
+	std::uint32_t prev = acc.column_height(0);
+	max_height = prev;
+
+	for(std::uint32_t x = 1; x < b.width; ++x) {
+		std::uint32_t h = acc.column_height(x);
+		bump += h > prev ? h - prev : prev - h;
+		max_height = h > max_height ? h : max_height;
+		prev = h;
+	}
+
+	out[f_aggregate_height] = acc.height;
+	out[f_holes] = acc.holes;
+	out[f_bumpiness] = bump;
+	out[f_wells] = acc.wells;
+	out[f_row_transitions] = acc.row_trans;
+	out[f_col_transitions] = acc.col_trans;
+	out[f_complete_lines] = lines;
+	out[f_max_height] = max_height;
+}
+
+#ifdef __GNUC__
+namespace detail {
+
+typedef std::uint32_t lanes4 __attribute__((vector_size(16)));
+
+// Four boards of equal size, one per vector lane
+inline void extract_features4(bitboard const *b, float *out)
+{
+	std::uint32_t width = b[0].width;
+	lanes4 full = lanes4{} + ((1u << width) - 1);
+
+	accumulator<lanes4> acc;
+	lanes4 lines{};
+
+	for(std::size_t y = 0; y < b[0].height; ++y) {
+		lanes4 r;
+		for(int i = 0; i < 4; ++i)
+			r[i] = b[i].rows[y];
+
+		acc.add_row(r, full, width);
+
+		// comparisons give -1 in every true lane
+		lines -= (lanes4)(r == full);
+	}
+
+	acc.col_trans += popcount32(acc.prev ^ full);
+
+	lanes4 prev = acc.column_height(0);
+	lanes4 max_height = prev;
+	lanes4 bump{};
+
+	for(std::uint32_t x = 1; x < width; ++x) {
+		lanes4 h = acc.column_height(x);
+		lanes4 up = (lanes4)(h > prev);
+		bump += ((h - prev) & up) | ((prev - h) & ~up);
+
+		lanes4 higher = (lanes4)(h > max_height);
+		max_height = (h & higher) | (max_height & ~higher);
+		prev = h;
+	}
+
+	for(int i = 0; i < 4; ++i) {
+		float *o = out + i * feature_count;
+		o[f_aggregate_height] = acc.height[i];
+		o[f_holes] = acc.holes[i];
+		o[f_bumpiness] = bump[i];
+		o[f_wells] = acc.wells[i];
+		o[f_row_transitions] = acc.row_trans[i];
+		o[f_col_transitions] = acc.col_trans[i];
+		o[f_complete_lines] = lines[i];
+		o[f_max_height] = max_height[i];
+	}
+}
+
+}
+#endif
+
+// Features of n boards into the row-major n by feature_count matrix out
+inline void extract_features(bitboard const *boards, std::size_t n, float *out)
+{
+	std::size_t i = 0;
+
+#ifdef __GNUC__
+	for(; i + 4 <= n; i += 4) {
+		bool same = true;
+		for(int k = 1; k < 4; ++k)
+			same = same && boards[i + k].width == boards[i].width
+			            && boards[i + k].height == boards[i].height;
+
+		if (same) {
+			detail::extract_features4(boards + i, out + i * feature_count);
+		} else {
+			for(int k = 0; k < 4; ++k)
+				extract_features(boards[i + k], out + (i + k) * feature_count);
+		}
+	}
+#endif
+
+	for(; i < n; ++i)
+		extract_features(boards[i], out + i * feature_count);
+}
+
+// Reference version walking the engine's nested vectors cell by cell.
+// Same definitions as above; kept for checking and benchmarking.
+inline void extract_features_naive(engine const& eng, float *out)
+{
+	int w = eng.width, h = eng.height;
+	auto filled = [&](int x, int y) {
+		if (x < 0 || x >= w || y >= h)
+			return true;
+		if (y < 0)
+			return false;
+		return eng.board[y][x] != 0;
+	};
+
+	for(int f = 0; f < feature_count; ++f)
+		out[f] = 0;
+
+	int prev_height = 0;
+	for(int x = 0; x < w; ++x) {
+		int height = 0;
+		bool covered = false;
+
+		for(int y = 0; y < h; ++y) {
+			if (filled(x, y)) {
+				if (!covered)
+					height = h - y;
+				covered = true;
+			} else if (covered) {
+				out[f_holes] += 1;
+			} else if (filled(x - 1, y) && filled(x + 1, y)) {
+				out[f_wells] += 1;
+			}
+
+			if (filled(x, y) != filled(x, y - 1))
+				out[f_col_transitions] += 1;
+		}
+
+		if (!filled(x, h - 1))
+			out[f_col_transitions] += 1;
+
+		out[f_aggregate_height] += height;
+		if (x > 0)
+			out[f_bumpiness] += std::abs(height - prev_height);
+		if (height > out[f_max_height])
+			out[f_max_height] = height;
+		prev_height = height;
+	}
+
+	for(int y = 0; y < h; ++y) {
+		bool full = true;
+		for(int x = -1; x < w; ++x) {
+			if (filled(x, y) != filled(x + 1, y))
+				out[f_row_transitions] += 1;
+			full = full && (x < 0 || filled(x, y));
+		}
+		out[f_complete_lines] += full;
+	}
+}
+
+}
+
+#endif // BOARD_FEATURES_H
@@ -0,0 +1,220 @@
+#ifndef BOARD_PAINTER_H
+#define BOARD_PAINTER_H
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include <final/final.h>
+
+#include "tetris_engine.h"
+#include "tetris_palette.h"
+
+namespace fc = finalcut;
+
+// Draws a game::engine board, its ghost and active piece, and piece
+// previews into any widget.  Positions are terminal cells relative to
+// the widget, so one painter can serve a whole window or one tile of it.
+//
+// In the default mode a board cell is scale_x by scale_y spaces in the
+// cell colour.  Half-block mode packs two board rows into each terminal
+// row with upper half block characters: foreground is the upper cell,
+// background the lower one.  A board cell is then scale_x / 4 columns
+// wide, at least one, and half a row tall, whatever scale_y.  A column
+// being about half as wide as a row is tall, that keeps cells as square
+// as the default 4x2 ones: one column at the default scale_x of 4, an
+// eighth of the terminal cells.
+class BoardPainter
+{
+public:
+	std::size_t scale_x = 4, scale_y = 2;
+	bool half_block = false;
+	bool draw_ghost = true;
+
+	TetrisPalette palette{TetrisPalette::classic()};
+
+	explicit BoardPainter(fc::FWidget& w)
+		: widget(w)
+	{}
+
+	// Terminal columns per board cell
+	std::size_t cellWidth() const
+	{
+		if (half_block)
+			return std::max(scale_x / 4, (std::size_t)1);
+		return scale_x;
+	}
+
+	// Terminal size of a board of w by h cells
+	std::size_t columns(std::size_t w) const
+	{
+		return w * cellWidth();
+	}
+
+	std::size_t rows(std::size_t h) const
+	{
+		if (half_block)
+			return (h + 1) / 2;
+		return h * scale_y;
+	}
+
+	fc::fc::colornames color(int cell, bool animating)
+	{
+		return palette.get(animating ? TetrisPalette::animating
+		                             : TetrisPalette::normal, cell);
+	}
+
+	// Board with ghost and active piece, its cell (0, 0) at terminal
+	// position (col, row).  The cells come from board, which is either
+	// eng.board or a copy being animated.
+	void drawBoard(game::engine& eng, decltype(game::engine::board) const& board,
+	               bool animating, int col, int row)
+	{
+		if (half_block) {
+			drawHalfBlockBoard(eng, board, animating, col, row);
+			return;
+		}
+
+		for(int y = 0; y != board.size(); ++y) {
+			for(int x = 0; x < board[y].size(); ++x) {
+				auto c = color(board[y][x], animating);
+				widget.setColor(c, c);
+
+				fillCell(x, y, col, row);
+			}
+		}
+
+		auto& ap = eng.active_piece;
+		if (!ap)
+			return;
+
+		if (draw_ghost) {
+			int y = eng.ghost_y();
+			if (y >= 0) {
+				auto c = palette.get(TetrisPalette::ghost, ap->id);
+				widget.setColor(c, c);
+
+				fillPiece(ap->orig_x, y, ap->blocks, col, row);
+			}
+		}
+
+		auto c = color(ap->id, animating);
+		widget.setColor(c, c);
+
+		fillPiece(ap->orig_x, ap->orig_y, ap->blocks, col, row);
+	}
+
+	// Piece preview in a box of 6 by 4 cells with the piece origin at
+	// cell (2, 1); preview pieces span x -2..3 and y -1..2.
+	void drawPreview(game::piece const& p, int col, int row)
+	{
+		auto c = color(p.id, false);
+
+		if (half_block) {
+			const std::size_t w = 6, h = 4;
+
+			cells.assign(w*h, fc::fc::Black);
+			paintPiece(2, 1, p.blocks, c, w, h);
+			printHalfBlocks(col, row, w, h);
+			return;
+		}
+
+		widget.setColor(c, c);
+		fillPiece(2, 1, p.blocks, col, row);
+	}
+
+private:
+	fc::FWidget& widget;
+	std::vector<fc::fc::colornames> cells;
+
+	// Fill one board cell, scaled up to scale_x by scale_y terminal
+	// cells, in the current colour.  Printing a single wide character
+	// rather than a string keeps this free of temporary FStrings.
+	void fillCell(int x, int y, int col, int row)
+	{
+		for(int sy = 0; sy < scale_y; ++sy) {
+			for(int sx = 0; sx < scale_x; ++sx) {
+				widget.print() << fc::FPoint(x*scale_x + col + sx, y*scale_y + row + sy);
+				widget.print(L' ');
+			}
+		}
+	}
+
+	void fillPiece(int x, int y, std::vector<std::pair<int, int>> const& blocks,
+	               int col, int row)
+	{
+		fillCell(x, y, col, row);
+
+		for(auto b : blocks)
+			fillCell(x + b.first, y + b.second, col, row);
+	}
+
+	// Paint a piece into the grid of cell colours, clipping to the grid
+	void paintPiece(int x, int y, std::vector<std::pair<int, int>> const& blocks,
+	                fc::fc::colornames c, std::size_t w, std::size_t h)
+	{
+		auto paint = [&](int px, int py) {
+			if (px >= 0 && px < w && py >= 0 && py < h)
+				cells[py*w + px] = c;
+		};
+
+		paint(x, y);
+		for(auto b : blocks)
+			paint(x + b.first, y + b.second);
+	}
+
+	// Print the grid of cell colours at terminal position (col, row)
+	// using upper half blocks, grid rows 2k and 2k + 1 in terminal row k.
+	void printHalfBlocks(int col, int row, std::size_t w, std::size_t h)
+	{
+		auto cw = cellWidth();
+
+		for(std::size_t hy = 0; hy < h; hy += 2) {
+			auto const *upper = &cells[hy * w];
+			auto const *lower = hy + 1 < h ? &cells[(hy + 1) * w] : nullptr;
+
+			for(std::size_t x = 0; x < w; ++x) {
+				auto fg = upper[x];
+				auto bg = lower ? lower[x] : fc::fc::Black;
+
+				widget.setColor(fg, bg);
+
+				for(std::size_t sx = 0; sx < cw; ++sx) {
+					widget.print() << fc::FPoint(col + x*cw + sx, row + hy/2);
+					if (fg == bg)
+						widget.print(L' ');
+					else
+						widget.print() << fc::fc::UpperHalfBlock;
+				}
+			}
+		}
+	}
+
+	void drawHalfBlockBoard(game::engine& eng, decltype(game::engine::board) const& board,
+	                        bool animating, int col, int row)
+	{
+		auto w = eng.width, h = eng.height;
+
+		cells.resize(w*h);
+
+		for(std::size_t y = 0; y < h; ++y)
+			for(std::size_t x = 0; x < w; ++x)
+				cells[y*w + x] = color(board[y][x], animating);
+
+		auto& ap = eng.active_piece;
+
+		if (draw_ghost && ap) {
+			int y = eng.ghost_y();
+			if (y >= 0)
+				paintPiece(ap->orig_x, y, ap->blocks,
+				           palette.get(TetrisPalette::ghost, ap->id), w, h);
+		}
+
+		if (ap)
+			paintPiece(ap->orig_x, ap->orig_y, ap->blocks, color(ap->id, animating), w, h);
+
+		printHalfBlocks(col, row, w, h);
+	}
+};
+
+#endif // BOARD_PAINTER_H
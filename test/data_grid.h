@@ -0,0 +1,116 @@
+#ifndef DATA_GRID_H
+#define DATA_GRID_H
+
+#include <string>
+#include <vector>
+
+#include <final/final.h>
+
+#include "grid_view.h"
+#include "partial_redraw.h"
+
+// Table widget over a grid::view: a line of column titles, then as many
+// rows as fit, pulled from the source only while they are shown.  Rows
+// scrolled away from are not redrawn unless the row in them changed, so
+// a frame costs at most the visible rows whatever the table's size.
+class DataGrid : public finalcut::FWidget
+{
+public:
+	DataGrid(finalcut::FWidget *parent, std::vector<grid::column> columns,
+	         grid::source source, std::size_t cache_rows = 1024)
+		: finalcut::FWidget(parent)
+		, table(std::move(columns), std::move(source), cache_rows)
+	{}
+
+	grid::view& view()
+	{
+		return table;
+	}
+
+	void setRows(std::uint64_t n)
+	{
+		table.set_rows(n);
+		drawn.repaint();
+	}
+
+	// The source's rows changed, ask for them again
+	void refresh()
+	{
+		table.invalidate();
+		redraw();
+	}
+
+	void scroll(std::int64_t rows)
+	{
+		table.scroll(rows);
+		drawn.repaint();
+	}
+
+	void scrollTo(std::uint64_t row)
+	{
+		table.scroll_to(row);
+		drawn.repaint();
+	}
+
+	// Rows that fit below the titles
+	std::size_t pageRows() const
+	{
+		return getHeight() > 1 ? getHeight() - 1 : 0;
+	}
+
+	void adjustSize() override
+	{
+		finalcut::FWidget::adjustSize();
+		table.resize(pageRows());
+	}
+
+	void draw() override
+	{
+		std::size_t rows = pageRows();
+		std::size_t cols = getWidth();
+
+		bool full = drawn.begin(rows, cols);
+
+		if (table.height() != rows)
+			table.resize(rows);
+
+		setColor();
+
+		if (full) {
+			blank = finalcut::FString(cols, L' ');
+			print() << finalcut::FPoint(1, 1) << cut(table.header(), cols);
+		}
+
+		table.visible([&](std::size_t i, std::uint64_t row, std::string const& line) {
+			if (!drawn.update(i, row))
+				return;
+			print() << finalcut::FPoint(1, int(i) + 2) << cut(line, cols);
+		});
+
+		// below the last row of a short table
+		for(auto i = std::size_t(std::min<std::uint64_t>(table.rows(), rows)); i < rows; ++i)
+			if (drawn.update(i, partial_redraw::empty))
+				print() << finalcut::FPoint(1, int(i) + 2) << blank;
+	}
+
+private:
+	grid::view table;
+
+	// the table row in each line, keyed by its number
+	partial_redraw drawn{*this};
+	finalcut::FString blank;
+
+	// the line as wide as the widget; rows are as wide as the header
+	// so the cut or the padding is the same for every line
+	finalcut::FString cut(std::string const& line, std::size_t cols) const
+	{
+		finalcut::FString text{line};
+		if (text.getLength() > cols)
+			return text.left(cols);
+		if (text.getLength() < cols)
+			text << finalcut::FString(cols - text.getLength(), L' ');
+		return text;
+	}
+};
+
+#endif // DATA_GRID_H
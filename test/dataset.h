@@ -0,0 +1,337 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "board_features.h"
+#include "mapped_file.h"
+#include "snapshot.h"
+#include "tetris_engine.h"
+
+namespace game {
+
+// Training samples in a columnar file: the state before an input (board,
+// active piece, next piece), the input, and the score it earned.
+//
+// The file is a dataset_header followed by blocks of block_rows samples,
+// all block_bytes long, so block i starts at a fixed offset and a mapped
+// file is read in place.  A block is a block_header and one column after
+// the other, each starting 8 byte aligned:
+//
+//   boards   std::uint64_t[block_rows][board_words]  cell (x, y) is bit
+//            y * width + x, set for a filled cell; the active piece is
+//            left out
+//   rewards  float[block_rows]
+//   active   piece_record[block_rows]  id 0 when no piece is falling
+//   next     std::uint8_t[block_rows]  piece id
+//   actions  std::uint8_t[block_rows]  game::action
+//
+// Only the first rows samples of a block are valid, the rest is zero;
+// only the last block is partly filled.  Native byte order.
+struct dataset_header
+{
+	static constexpr std::uint32_t magic_value = 0x54414454;  // "TDAT"
+	static constexpr std::uint32_t current_version = 1;
+
+	std::uint32_t magic;
+	std::uint32_t version;
+	std::uint16_t width, height;
+	std::uint32_t board_words;
+	std::uint32_t block_rows;
+	std::uint32_t reserved0;
+	std::uint64_t block_bytes;
+	std::uint8_t reserved1[32];
+};
+
+static_assert(sizeof(dataset_header) == 64, "dataset layout changed, bump its version");
+
+struct block_header
+{
+	static constexpr std::uint32_t magic_value = 0x4b4c4254;  // "TBLK"
+
+	std::uint32_t magic;
+	std::uint32_t rows;
+	std::uint64_t first_row;
+};
+
+// Column offsets of a block of the given shape
+struct block_layout
+{
+	std::size_t board_words, block_rows;
+	std::size_t boards, rewards, active, next, actions, bytes;
+
+	block_layout(std::size_t w, std::size_t h, std::size_t rows)
+		: board_words((w * h + 63) / 64)
+		, block_rows(rows)
+	{
+		auto align = [](std::size_t n) { return (n + 7) / 8 * 8; };
+
+		boards = sizeof(block_header);
+		rewards = align(boards + rows * board_words * sizeof(std::uint64_t));
+		active = align(rewards + rows * sizeof(float));
+		next = align(active + rows * sizeof(piece_record));
+		actions = align(next + rows);
+		bytes = align(actions + rows);
+	}
+};
+
+// Streams samples into a dataset file.  Samples are gathered in one of
+// two block buffers; a full one is handed to a writer thread, which
+// writes it out while the other fills, so adding a sample costs a board
+// conversion and never waits on the disk unless the writer falls a whole
+// block behind.  Samples come from one thread.
+class dataset_writer
+{
+public:
+	dataset_writer(std::string const& path, std::size_t w, std::size_t h,
+	               std::size_t rows = 4096)
+		: layout(w, h, rows)
+		, width(w)
+		, height(h)
+		, out(path, std::ios::binary | std::ios::trunc)
+	{
+		dataset_header hd{};
+		hd.magic = dataset_header::magic_value;
+		hd.version = dataset_header::current_version;
+		hd.width = w;
+		hd.height = h;
+		hd.board_words = layout.board_words;
+		hd.block_rows = rows;
+		hd.block_bytes = layout.bytes;
+		out.write(reinterpret_cast<const char *>(&hd), sizeof(hd));
+		good = bool(out);
+
+		for(auto& b : buffers)
+			b.assign(layout.bytes, 0);
+
+		writer = std::thread([this] { write_blocks(); });
+	}
+
+	~dataset_writer()
+	{
+		close();
+	}
+
+	dataset_writer(dataset_writer const&) = delete;
+	dataset_writer& operator=(dataset_writer const&) = delete;
+
+	bool ok() const
+	{
+		return good;
+	}
+
+	std::uint64_t samples() const
+	{
+		return first_row + filled;
+	}
+
+	// Take the state a sample starts from
+	void observe(engine const& eng)
+	{
+		auto *b = buffers[front].data();
+		auto *words = reinterpret_cast<std::uint64_t *>(b + layout.boards)
+		            + filled * layout.board_words;
+
+		auto bits = to_bitboard(eng, false);
+		for(std::size_t y = 0; y < height; ++y) {
+			std::uint64_t row = bits.rows[y];
+			std::size_t at = y * width;
+
+			words[at / 64] |= row << (at % 64);
+			if (at % 64 + width > 64)
+				words[at / 64 + 1] |= row >> (64 - at % 64);
+		}
+
+		reinterpret_cast<piece_record *>(b + layout.active)[filled] =
+			save_piece(eng.active_piece.get());
+		reinterpret_cast<std::uint8_t *>(b + layout.next)[filled] =
+			eng.next_piece->id;
+	}
+
+	// Finish the sample begun by observe()
+	void commit(action a, float reward)
+	{
+		auto *b = buffers[front].data();
+		reinterpret_cast<float *>(b + layout.rewards)[filled] = reward;
+		reinterpret_cast<std::uint8_t *>(b + layout.actions)[filled] = std::uint8_t(a);
+
+		if (++filled == layout.block_rows)
+			hand_off();
+	}
+
+	// Record the input apply() makes, rewarded with the score it adds
+	template <typename F>
+	void capture(engine& eng, action a, F&& apply)
+	{
+		observe(eng);
+		int before = eng.score;
+		apply();
+		commit(a, eng.score - before);
+	}
+
+	// Write what is left and wait for the writer; no more samples after
+	void close()
+	{
+		if (!writer.joinable())
+			return;
+
+		if (filled)
+			hand_off();
+
+		{
+			std::unique_lock<std::mutex> lock(m);
+			stopping = true;
+		}
+		cv.notify_all();
+		writer.join();
+
+		good = good && bool(out.flush());
+		out.close();
+	}
+
+private:
+	block_layout layout;
+	std::size_t width, height;
+	std::ofstream out;
+	std::atomic<bool> good{true};
+
+	std::vector<char> buffers[2];
+	int front{0};
+	std::size_t filled{0};
+	std::uint64_t first_row{0};
+
+	std::thread writer;
+	std::mutex m;
+	std::condition_variable cv;
+	bool pending{false};
+	bool stopping{false};
+
+	void hand_off()
+	{
+		auto *h = reinterpret_cast<block_header *>(buffers[front].data());
+		h->magic = block_header::magic_value;
+		h->rows = filled;
+		h->first_row = first_row;
+
+		std::unique_lock<std::mutex> lock(m);
+		cv.wait(lock, [&] { return !pending; });
+
+		front = 1 - front;
+		pending = true;
+		first_row += filled;
+		filled = 0;
+
+		cv.notify_all();
+	}
+
+	void write_blocks()
+	{
+		std::unique_lock<std::mutex> lock(m);
+
+		for(;;) {
+			cv.wait(lock, [&] { return pending || stopping; });
+			if (!pending)
+				return;
+
+			// the producer only touches the front buffer
+			auto& back = buffers[1 - front];
+			lock.unlock();
+
+			out.write(back.data(), back.size());
+			bool written = bool(out);
+			std::memset(back.data(), 0, back.size());
+
+			lock.lock();
+			good = good && written;
+			pending = false;
+			cv.notify_all();
+		}
+	}
+};
+
+// A dataset file mapped read-only
+class dataset_file
+{
+public:
+	struct block
+	{
+		std::size_t rows{0};
+		std::uint64_t first_row{0};
+		std::uint64_t const *boards{nullptr};
+		float const *rewards{nullptr};
+		piece_record const *active{nullptr};
+		std::uint8_t const *next{nullptr};
+		std::uint8_t const *actions{nullptr};
+	};
+
+	explicit dataset_file(std::string const& path)
+		: file(path)
+	{}
+
+	bool ok() const
+	{
+		if (file.size() < sizeof(dataset_header))
+			return false;
+
+		auto const& h = header();
+		return h.magic == dataset_header::magic_value
+		    && h.version == dataset_header::current_version
+		    && h.block_bytes > 0
+		    && (file.size() - sizeof(h)) % h.block_bytes == 0;
+	}
+
+	dataset_header const& header() const
+	{
+		return *reinterpret_cast<dataset_header const *>(file.data());
+	}
+
+	std::size_t blocks() const
+	{
+		return ok() ? (file.size() - sizeof(dataset_header)) / header().block_bytes : 0;
+	}
+
+	block operator[](std::size_t i) const
+	{
+		auto const& h = header();
+		block_layout layout(h.width, h.height, h.block_rows);
+		auto const *b = file.data() + sizeof(h) + i * h.block_bytes;
+		auto const *bh = reinterpret_cast<block_header const *>(b);
+
+		block r;
+		if (bh->magic != block_header::magic_value)
+			return r;
+
+		r.rows = bh->rows;
+		r.first_row = bh->first_row;
+		r.boards = reinterpret_cast<std::uint64_t const *>(b + layout.boards);
+		r.rewards = reinterpret_cast<float const *>(b + layout.rewards);
+		r.active = reinterpret_cast<piece_record const *>(b + layout.active);
+		r.next = reinterpret_cast<std::uint8_t const *>(b + layout.next);
+		r.actions = reinterpret_cast<std::uint8_t const *>(b + layout.actions);
+
+		return r;
+	}
+
+	// Whether cell (x, y) of sample row of b is filled
+	bool cell(block const& b, std::size_t row, std::size_t x, std::size_t y) const
+	{
+		auto const& h = header();
+		std::size_t bit = y * h.width + x;
+		return (b.boards[row * h.board_words + bit / 64] >> (bit % 64)) & 1;
+	}
+
+private:
+	mapped_file file;
+};
+
+}
+
+#endif // DATASET_H
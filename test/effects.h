@@ -0,0 +1,457 @@
+#ifndef EFFECTS_H
+#define EFFECTS_H
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "timing_wheel.h"
+
+// Multi-frame effects written as C++20 coroutines, all driven from one
+// timer: the widget calls scheduler::tick() from onTimer, and an effect
+// co_awaits frames, a deadline or a condition between its steps.  An
+// effect may also co_await another effect to run it to its end, which
+// is how a sequence of phases reads like straight code.
+//
+// Waiting costs nothing beyond a node in an intrusive list that lives in
+// the coroutine frame itself, deadlines go on a timing wheel instead of
+// being looked at every tick, and frames come from a pool of fixed-size
+// blocks that is reused, so starting and finishing effects does not
+// touch the heap once the pool has grown to the number running at once.
+// Everything runs on the thread calling tick().
+namespace effects {
+
+using clock = std::chrono::steady_clock;
+
+// Free list of equal blocks for coroutine frames; bigger frames go to
+// the heap.
+class frame_pool
+{
+public:
+	static constexpr std::size_t block_size = 1024;
+
+	static frame_pool& get()
+	{
+		static frame_pool pool;
+		return pool;
+	}
+
+	void *allocate(std::size_t n)
+	{
+		if (n > block_size)
+			return ::operator new(n);
+
+		if (!free_list) {
+			// blocks are never given back, a pool only grows to the
+			// most frames alive at once
+			auto *chunk = static_cast<char *>(::operator new(block_size * chunk_blocks));
+			for(std::size_t i = 0; i < chunk_blocks; ++i)
+				release(chunk + i * block_size);
+			++chunks;
+		}
+
+		auto *b = free_list;
+		free_list = b->next;
+		return b;
+	}
+
+	void deallocate(void *p, std::size_t n)
+	{
+		if (n > block_size)
+			::operator delete(p);
+		else
+			release(p);
+	}
+
+	// Blocks taken from the heap so far
+	std::size_t capacity() const
+	{
+		return chunks * chunk_blocks;
+	}
+
+private:
+	static constexpr std::size_t chunk_blocks = 16;
+
+	struct block
+	{
+		block *next;
+	};
+
+	block *free_list{nullptr};
+	std::size_t chunks{0};
+
+	void release(void *p)
+	{
+		auto *b = static_cast<block *>(p);
+		b->next = free_list;
+		free_list = b;
+	}
+};
+
+class scheduler;
+
+// A coroutine returning effect is an effect.  It does not run until it
+// is handed to scheduler::start() or co_awaited by another effect, and
+// the object owns its frame.
+class effect
+{
+public:
+	struct promise_type;
+	using handle = std::coroutine_handle<promise_type>;
+
+	struct promise_type
+	{
+		std::coroutine_handle<> continuation;
+
+		effect get_return_object()
+		{
+			return effect{handle::from_promise(*this)};
+		}
+
+		std::suspend_always initial_suspend() noexcept
+		{
+			return {};
+		}
+
+		// back to the effect awaiting this one, if any
+		struct final_awaiter
+		{
+			bool await_ready() noexcept
+			{
+				return false;
+			}
+
+			std::coroutine_handle<> await_suspend(handle h) noexcept
+			{
+				if (auto c = h.promise().continuation)
+					return c;
+				return std::noop_coroutine();
+			}
+
+			void await_resume() noexcept
+			{}
+		};
+
+		final_awaiter final_suspend() noexcept
+		{
+			return {};
+		}
+
+		void return_void()
+		{}
+
+		void unhandled_exception()
+		{
+			std::terminate();
+		}
+
+		static void *operator new(std::size_t n)
+		{
+			return frame_pool::get().allocate(n);
+		}
+
+		static void operator delete(void *p, std::size_t n)
+		{
+			frame_pool::get().deallocate(p, n);
+		}
+	};
+
+	effect(effect&& o) noexcept
+		: h(std::exchange(o.h, {}))
+	{}
+
+	effect& operator=(effect&& o) noexcept
+	{
+		std::swap(h, o.h);
+		return *this;
+	}
+
+	~effect()
+	{
+		if (h)
+			h.destroy();
+	}
+
+	// co_await runs the effect to its end
+	bool await_ready() const noexcept
+	{
+		return !h || h.done();
+	}
+
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> parent) noexcept
+	{
+		h.promise().continuation = parent;
+		return h;
+	}
+
+	void await_resume() const noexcept
+	{}
+
+private:
+	friend class scheduler;
+
+	handle h;
+
+	explicit effect(handle c)
+		: h(c)
+	{}
+};
+
+class scheduler
+{
+	// An effect suspended on a condition, linked into the waiting list
+	// until tick() finds it ready
+	struct waiter
+	{
+		scheduler *owner{nullptr};
+		std::coroutine_handle<> h;
+		waiter *next{nullptr};
+		waiter **prev{nullptr};
+
+		waiter() = default;
+		waiter(waiter const&) = delete;
+		waiter& operator=(waiter const&) = delete;
+
+		~waiter()
+		{
+			unlink();
+		}
+
+		void link(waiter *&head)
+		{
+			next = head;
+			prev = &head;
+			if (head)
+				head->prev = &next;
+			head = this;
+		}
+
+		void unlink()
+		{
+			if (!prev)
+				return;
+			*prev = next;
+			if (next)
+				next->prev = prev;
+			next = nullptr;
+			prev = nullptr;
+		}
+
+		virtual bool ready(clock::time_point now) = 0;
+	};
+
+	// the waiter base goes into the coroutine frame with the awaiter
+	template <typename Ready>
+	struct awaiter : waiter
+	{
+		Ready is_ready;
+
+		awaiter(scheduler& s, Ready r)
+			: is_ready(std::move(r))
+		{
+			this->owner = &s;
+		}
+
+		bool await_ready()
+		{
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> c)
+		{
+			this->h = c;
+			this->link(this->owner->waiting);
+		}
+
+		void await_resume()
+		{}
+
+		bool ready(clock::time_point now) override
+		{
+			return is_ready(now);
+		}
+	};
+
+	template <typename Ready>
+	awaiter<Ready> make(Ready r)
+	{
+		return awaiter<Ready>(*this, std::move(r));
+	}
+
+	// a waiter the wheel puts on the ready list at its deadline
+	struct deadline : waiter
+	{
+		timing_wheel::timer alarm;
+		clock::time_point due;
+
+		deadline(scheduler& s, clock::time_point t)
+			: due(t)
+		{
+			this->owner = &s;
+		}
+
+		bool await_ready()
+		{
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> c)
+		{
+			this->h = c;
+			alarm.action = [this] { this->link(this->owner->ready); };
+			this->owner->timers.schedule(alarm, due);
+		}
+
+		void await_resume()
+		{}
+
+		bool ready(clock::time_point) override
+		{
+			return true;
+		}
+	};
+
+public:
+	scheduler()
+	{
+		running.reserve(16);
+	}
+
+	~scheduler()
+	{
+		stop_all();
+	}
+
+	scheduler(scheduler const&) = delete;
+	scheduler& operator=(scheduler const&) = delete;
+
+	// Run e until it first waits; it is then resumed from tick()
+	void start(effect e)
+	{
+		auto h = std::exchange(e.h, {});
+		running.push_back(h);
+		h.resume();
+	}
+
+	// Destroy every running effect wherever it waits; not from inside
+	// an effect
+	void stop_all()
+	{
+		// destroying a frame unlinks its waiter
+		auto all = std::move(running);
+		running.clear();
+		for(auto h : all)
+			h.destroy();
+	}
+
+	bool idle() const
+	{
+		return running.empty();
+	}
+
+	std::size_t size() const
+	{
+		return running.size();
+	}
+
+	// Ticks so far, for effects that animate by frame
+	std::uint64_t frame() const
+	{
+		return frames_done;
+	}
+
+	// Time of the current tick
+	clock::time_point now() const
+	{
+		return tick_time;
+	}
+
+	// Timers of the owner, fired at the start of each tick
+	timing_wheel& wheel()
+	{
+		return timers;
+	}
+
+	// Resume every effect whose condition holds at now; effects that
+	// start waiting during the tick are looked at from the next one.
+	void tick(clock::time_point now = clock::now())
+	{
+		tick_time = now;
+		++frames_done;
+
+		timers.advance(now);
+
+		for(auto *w = waiting; w; ) {
+			auto *next = w->next;
+			if (w->ready(now)) {
+				w->unlink();
+				w->link(ready);
+			}
+			w = next;
+		}
+
+		// a resumed effect may stop others, whose waiters then leave
+		// this list by themselves
+		while(auto *w = ready) {
+			w->unlink();
+			w->h.resume();
+		}
+
+		for(std::size_t i = 0; i < running.size(); )
+			if (running[i].done()) {
+				running[i].destroy();
+				running[i] = running.back();
+				running.pop_back();
+			} else {
+				++i;
+			}
+	}
+
+	// Awaitables for effects
+
+	// Resumes n ticks from now, at least one
+	auto frames(std::uint64_t n)
+	{
+		return make([n](clock::time_point) mutable { return n <= 1 || (--n, false); });
+	}
+
+	auto next_frame()
+	{
+		return frames(1);
+	}
+
+	// Resumes on the first tick at or after t
+	deadline at(clock::time_point t)
+	{
+		return deadline(*this, t);
+	}
+
+	auto sleep(clock::duration d)
+	{
+		return at(clock::now() + d);
+	}
+
+	// Resumes on the first tick at which pred() is true
+	template <typename Pred>
+	auto until(Pred pred)
+	{
+		return make([pred](clock::time_point) { return pred(); });
+	}
+
+private:
+	timing_wheel timers;
+	std::vector<effect::handle> running;
+	waiter *waiting{nullptr};
+	waiter *ready{nullptr};
+	clock::time_point tick_time{clock::now()};
+	std::uint64_t frames_done{0};
+};
+
+}
+
+#endif // EFFECTS_H
@@ -0,0 +1,795 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <cstdlib>
+
+#include "alloc_stats.h"
+#include "autoplay.h"
+#include "board_features.h"
+#include "history.h"
+#include "movegen.h"
+#include "perf_counters.h"
+#include "placement.h"
+#include "search.h"
+#include "snapshot.h"
+#include "tetris_engine.h"
+#include "vec_env.h"
+
+// Headless engine benchmark: drives game::engine with a fixed input
+// pattern and reports time and heap allocations per engine call.
+//
+//   engine_bench [--ticks N] [--budget N] [--perf] [--json]
+//   engine_bench --vec-env N [--threads N] [--ticks N] [--checkpoint FILE]
+//   engine_bench --features N [--ticks N]
+//   engine_bench --movegen N
+//   engine_bench --placements N
+//   engine_bench --history N
+//   engine_bench --search N [--depth N] [--preview N] [--budget-us N]
+//
+// --perf adds hardware counters (see perf_counters.h) for every call,
+// --json writes the results as one JSON object instead of a table.
+//
+// --vec-env instead steps a game::vec_env of N environments with
+// random actions for --ticks batches and reports environment steps per
+// second.  With --checkpoint it then saves all environments to FILE and
+// loads them back, timing both.
+//
+// --features collects N boards from randomly played games and computes
+// their heuristic features (board_features.h) --ticks times over, with
+// the per-cell loop, the per-board bitboard code and the batched code,
+// checking that all three agree.
+//
+// --movegen plays N pieces with the autoplayer and times the reachable
+// placement search (movegen.h) for each, replaying every path found on a
+// copy of the engine to check it ends where the search said.
+//
+// --placements tests N random placements on random boards of widths
+// 7, 10 and 15 with the row masks of placement.h, with
+// engine::check_collision(), which uses them, and cell by cell, checking
+// that all agree; where the piece fits, engine::ghost_y() and
+// placement_table::drop() are checked against a drop cell by cell.
+//
+// --history plays N pieces with random moves, garbage and board
+// resets, recording every piece into a game::board_history and a full
+// copy of the engine next to it.  Now and then it rewinds a few pieces,
+// and after every piece it restores a random past one into another
+// engine, checking both against the copies.
+//
+// --search plays N pieces with the lookahead bot (search.h) and with the
+// greedy one on the same piece sequence and compares their games.
+//
+// Exits with status 1 if any call, or any whole tick with everything
+// in it, allocates more than --budget times once warmed up.
+
+namespace {
+
+struct call_stats
+{
+	const char *name;
+
+	std::uint64_t calls{0};
+	alloc_stats::counters allocs{};
+	std::uint64_t worst_allocs{0};
+	std::chrono::nanoseconds time{0};
+	perf::sample counters{};
+
+	explicit call_stats(const char *n)
+		: name(n)
+	{}
+
+	// The counter reads sit outside the timed region so their syscalls
+	// do not show up in ns/call.
+	template <typename F>
+	void measure(F&& f, perf::group const *pmu)
+	{
+		perf::sample before;
+		if (pmu)
+			before = pmu->read();
+
+		alloc_stats::scope scope;
+		auto start = std::chrono::steady_clock::now();
+
+		f();
+
+		time += std::chrono::steady_clock::now() - start;
+		auto d = scope.delta();
+
+		if (pmu)
+			counters += pmu->read() - before;
+
+		allocs.allocs += d.allocs;
+		allocs.frees += d.frees;
+		allocs.bytes += d.bytes;
+		worst_allocs = std::max(worst_allocs, d.allocs);
+		++calls;
+	}
+
+	void add(call_stats const& rhs)
+	{
+		calls += rhs.calls;
+		allocs.allocs += rhs.allocs.allocs;
+		allocs.frees += rhs.allocs.frees;
+		allocs.bytes += rhs.allocs.bytes;
+		worst_allocs = std::max(worst_allocs, rhs.worst_allocs);
+		time += rhs.time;
+		counters += rhs.counters;
+	}
+};
+
+// Restart from the same well-shaped board as the game does once the
+// stack gets near the spawn rows, so the benchmark never runs into a
+// game over and keeps clearing lines.
+const int well_x = 7;
+
+void keep_alive(game::engine& eng)
+{
+	if (eng.active_piece)
+		return;
+
+	bool high = false;
+	for(int y = 0; y < 6; ++y)
+		for(auto c : eng.board[y])
+			high = high || c != 0;
+
+	if (!high)
+		return;
+
+	for(std::size_t y = 0; y < eng.height; ++y)
+		for(std::size_t x = 0; x < eng.width; ++x)
+			eng.board[y][x] = (y + 4 >= eng.height && x != well_x) ? 's' : 0;
+
+	eng.dirty_rows = ~0ull;
+	++eng.version;
+}
+
+int bench_vec_env(std::size_t n, std::size_t threads, long ticks,
+                  std::string const& checkpoint)
+{
+	game::vec_env env{n, 10, 20, 1, threads};
+
+	std::vector<std::uint8_t> obs(env.size() * env.observation_size());
+	std::vector<game::action> actions(env.size());
+	std::uint32_t rng = 2463534242u;
+
+	env.reset(obs.data());
+
+	long episodes = 0;
+	auto start = std::chrono::steady_clock::now();
+
+	for(long t = 0; t < ticks; ++t) {
+		for(auto& a : actions) {
+			rng ^= rng << 13;
+			rng ^= rng >> 17;
+			rng ^= rng << 5;
+			a = game::action(rng % 5);
+		}
+
+		env.step(actions.data(), obs.data());
+
+		for(auto d : env.dones)
+			episodes += d;
+	}
+
+	std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+	double steps = double(ticks) * env.size();
+
+	std::cout << env.size() << " envs, " << threads << " threads: "
+	          << steps / secs.count() << " steps/s, "
+	          << episodes << " episodes\n";
+
+	if (!checkpoint.empty()) {
+		auto t0 = std::chrono::steady_clock::now();
+		bool saved = env.save(checkpoint);
+		auto t1 = std::chrono::steady_clock::now();
+		bool loaded = saved && env.load(checkpoint);
+		auto t2 = std::chrono::steady_clock::now();
+
+		if (!loaded) {
+			std::cerr << "checkpoint " << checkpoint << " failed\n";
+			return 1;
+		}
+
+		std::chrono::duration<double, std::milli> save_ms = t1 - t0, load_ms = t2 - t1;
+		std::cout << "checkpoint of " << env.size() << " games: save "
+		          << save_ms.count() << " ms, load " << load_ms.count() << " ms\n";
+	}
+
+	return 0;
+}
+
+int bench_features(std::size_t n, long rounds)
+{
+	std::vector<game::engine> boards;
+	game::engine eng{10, 20, 1};
+	eng.reset();
+
+	std::uint32_t rng = 2463534242u;
+	while(boards.size() < n) {
+		rng ^= rng << 13;
+		rng ^= rng >> 17;
+		rng ^= rng << 5;
+
+		eng.step(game::action(rng % 5));
+		if (eng.game_over)
+			eng.restart();
+		else if (!eng.active_piece)
+			boards.push_back(eng);
+	}
+
+	std::vector<game::bitboard> bits;
+	for(auto const& b : boards)
+		bits.push_back(game::to_bitboard(b));
+
+	std::vector<float> naive(n * game::feature_count);
+	std::vector<float> single(naive.size()), batch(naive.size());
+
+	auto time = [&](auto&& f) {
+		auto start = std::chrono::steady_clock::now();
+		for(long r = 0; r < rounds; ++r)
+			f();
+		std::chrono::duration<double, std::nano> d =
+			std::chrono::steady_clock::now() - start;
+		return d.count() / (double(rounds) * n);
+	};
+
+	double naive_ns = time([&] {
+		for(std::size_t i = 0; i < n; ++i)
+			game::extract_features_naive(boards[i], &naive[i * game::feature_count]);
+	});
+
+	double single_ns = time([&] {
+		for(std::size_t i = 0; i < n; ++i)
+			game::extract_features(bits[i], &single[i * game::feature_count]);
+	});
+
+	double batch_ns = time([&] {
+		game::extract_features(bits.data(), n, batch.data());
+	});
+
+	if (naive != single || naive != batch) {
+		std::cerr << "feature mismatch\n";
+		return 1;
+	}
+
+	std::cout << n << " boards, ns/board: per-cell " << naive_ns
+	          << ", bitboard " << single_ns
+	          << ", batched " << batch_ns << "\n";
+
+	return 0;
+}
+
+int bench_movegen(long pieces)
+{
+	game::engine eng{10, 20, 1};
+	eng.reset();
+
+	game::autoplayer player;
+	game::move_generator gen;
+
+	std::chrono::nanoseconds time{0};
+	long searches = 0, landings = 0, games = 1;
+
+	while(searches < pieces) {
+		if (eng.game_over) {
+			eng.restart();
+			++games;
+		}
+
+		if (eng.active_piece && eng.active_piece->orig_y == 2) {
+			auto start = std::chrono::steady_clock::now();
+			gen.generate(eng);
+			time += std::chrono::steady_clock::now() - start;
+
+			++searches;
+			landings += gen.size();
+
+			for(auto const& l : gen) {
+				game::engine sim = eng;
+				gen.play(sim, l);
+
+				auto& ap = sim.active_piece;
+				if (!ap || ap->orig_x != l.x || ap->orig_y != l.y) {
+					std::cerr << "path to " << l.x << "," << l.y << " r" << l.rotation
+					          << " ends elsewhere\n" << eng;
+					return 1;
+				}
+			}
+		}
+
+		player.step(eng);
+	}
+
+	std::cout << searches << " searches, " << games << " games: "
+	          << double(landings) / searches << " landings and "
+	          << time.count() / 1000.0 / searches << " us per search\n";
+
+	return 0;
+}
+
+int bench_placements(long n)
+{
+	std::uint32_t rng = 2463534242u;
+	auto next = [&](std::uint32_t range) {
+		rng ^= rng << 13;
+		rng ^= rng >> 17;
+		rng ^= rng << 5;
+		return rng % range;
+	};
+
+	long checks = 0, collisions = 0, drops = 0;
+
+	for(std::size_t width : {7, 10, 15}) {
+		game::engine eng{width, 20, 1};
+		eng.reset();
+
+		auto const& table = game::placement_masks_for(width);
+
+		// the piece is on the board only while its ghost is looked up,
+		// so every cell counts
+		game::bitboard b;
+
+		for(long i = 0; i < n / 3; ++i) {
+			// a new board every 64 placements, an eighth of it filled
+			if (i % 64 == 0) {
+				for(auto& row : eng.board)
+					for(auto& c : row)
+						c = next(8) == 0 ? (next(2) ? 's' : game::engine::garbage_cell) : 0;
+				eng.dirty_rows = ~0ull;
+				++eng.version;
+				b = game::to_bitboard(eng);
+			}
+
+			auto kind = next(7);
+			eng.active_piece = game::engine::make_piece(kind);
+			for(auto r = next(4); r > 0; --r)
+				eng.active_piece->rotate();
+
+			auto& ap = *eng.active_piece;
+			ap.orig_x = int(next(width + 4)) - 2;
+			ap.orig_y = next(eng.height + 1);
+
+			int r = game::rotation_of(ap);
+			bool masked = r >= 0 && table.collides(b, table(kind, r, ap.orig_x), ap.orig_y);
+			bool walked = eng.check_collision_cells();
+			if (r < 0 || masked != walked || eng.check_collision() != walked) {
+				std::cerr << "width " << width << ": piece " << char(ap.id) << " r" << r
+				          << " at " << ap.orig_x << "," << ap.orig_y << " masks say "
+				          << masked << ", check_collision " << eng.check_collision()
+				          << ", cell by cell " << walked << "\n" << eng;
+				return 1;
+			}
+
+			++checks;
+			collisions += walked;
+			if (walked)
+				continue;
+
+			// ghost_y() on the masks against a drop cell by cell
+			int from = ap.orig_y;
+			while(!eng.check_collision_cells())
+				++ap.orig_y;
+			int landed = ap.orig_y - 1;
+			ap.orig_y = from;
+
+			eng.cement_piece();
+			int ghost = eng.ghost_y();
+			eng.clear_active_piece();
+
+			if (ghost != landed || table.drop(b, table(kind, r, ap.orig_x), from) != landed) {
+				std::cerr << "width " << width << ": piece " << char(ap.id) << " r" << r
+				          << " at " << ap.orig_x << "," << from << " lands on " << landed
+				          << ", ghost_y says " << ghost << "\n" << eng;
+				return 1;
+			}
+
+			++drops;
+		}
+	}
+
+	std::cout << checks << " placements, " << collisions << " collisions, "
+	          << drops << " drops, masks and cells agree\n";
+
+	return 0;
+}
+
+// What board_history keeps of an engine, to compare as bytes; the
+// version is bumped by every restore and the seed is not kept
+game::snapshot kept_state(game::engine const& eng)
+{
+	auto s = game::take_snapshot(eng);
+	s.engine_version = 0;
+	s.seed = 0;
+	return s;
+}
+
+bool same_state(game::engine const& eng, game::snapshot const& s)
+{
+	auto now = kept_state(eng);
+	return std::memcmp(&now, &s, sizeof(s)) == 0;
+}
+
+int bench_history(long pieces)
+{
+	const std::size_t capacity = 32;
+
+	game::engine eng{15, 19, 1};
+	eng.reset();
+
+	game::board_history history{eng, capacity};
+	game::engine branch{15, 19};
+	std::deque<game::snapshot> copies;
+
+	std::uint32_t rng = 2463534242u;
+	auto next = [&](std::uint32_t range) {
+		rng ^= rng << 13;
+		rng ^= rng >> 17;
+		rng ^= rng << 5;
+		return rng % range;
+	};
+
+	long placed = 0, rewinds = 0, restores = 0;
+	bool had_piece = false;
+
+	while(placed < pieces) {
+		if (eng.game_over)
+			eng.restart();
+
+		keep_alive(eng);
+		if (next(40) == 0)
+			eng.add_garbage(1 + next(2), next(eng.width));
+
+		eng.step(game::action(next(5)));
+
+		bool spawned = eng.active_piece && !had_piece;
+		had_piece = bool(eng.active_piece);
+		if (!spawned)
+			continue;
+
+		history.record();
+		copies.push_back(kept_state(eng));
+		if (copies.size() > capacity)
+			copies.pop_front();
+		++placed;
+
+		if (placed % 25 == 0) {
+			auto n = history.rewind(next(4));
+			copies.resize(copies.size() - n);
+			++rewinds;
+
+			if (!same_state(eng, copies.back())) {
+				std::cerr << "rewind of " << n << " pieces at piece " << placed
+				          << " differs\n" << eng;
+				return 1;
+			}
+		}
+
+		auto back = next(history.size());
+		history.restore_into(branch, back);
+		++restores;
+
+		if (!same_state(branch, copies[copies.size() - 1 - back])) {
+			std::cerr << "state " << back << " pieces back at piece " << placed
+			          << " differs\n" << branch;
+			return 1;
+		}
+	}
+
+	std::cout << placed << " pieces, " << rewinds << " rewinds and "
+	          << restores << " restores, all as recorded\n";
+
+	return 0;
+}
+
+int bench_search(long pieces, game::search_options const& options)
+{
+	auto play = [&](bool lookahead) {
+		game::engine eng{10, 20, 1};
+		eng.reset();
+
+		game::searcher bot;
+		bot.options = options;
+		game::autoplayer greedy;
+
+		long placed = 0, lines = 0, games = 1, depth = 0;
+		std::chrono::nanoseconds time{0};
+
+		while(placed < pieces) {
+			if (eng.game_over) {
+				eng.restart();
+				++games;
+			}
+
+			if (!lookahead) {
+				if (eng.active_piece && eng.active_piece->orig_y == 2)
+					++placed;
+				lines += greedy.step(eng).size();
+				continue;
+			}
+
+			eng.update();
+			if (!eng.active_piece)
+				continue;
+
+			auto start = std::chrono::steady_clock::now();
+			auto res = bot.search(eng);
+			time += std::chrono::steady_clock::now() - start;
+
+			if (res.best)
+				bot.play(eng, *res.best);
+			depth += res.depth;
+			++placed;
+
+			while(eng.active_piece)
+				lines += eng.update().size();
+		}
+
+		std::cout << (lookahead ? "lookahead: " : "greedy:    ")
+		          << placed << " pieces, " << games << " games, "
+		          << lines << " lines";
+		if (lookahead)
+			std::cout << ", depth " << double(depth) / placed
+			          << ", " << time.count() / 1e6 / placed << " ms per move";
+		std::cout << "\n";
+	};
+
+	play(false);
+	play(true);
+
+	return 0;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	long ticks = 200000;
+	std::uint64_t budget = 0;
+	bool use_perf = false;
+	bool json = false;
+	std::size_t vec_envs = 0;
+	std::size_t threads = 1;
+	std::string checkpoint;
+	std::size_t features = 0;
+	long movegen = 0;
+	long placements = 0;
+	long history_pieces = 0;
+	long search = 0;
+	game::search_options search_options;
+
+	for(int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+
+		if (arg == "--ticks" && i + 1 < argc)
+			ticks = std::atol(argv[++i]);
+		else if (arg == "--budget" && i + 1 < argc)
+			budget = std::strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--perf")
+			use_perf = true;
+		else if (arg == "--json")
+			json = true;
+		else if (arg == "--vec-env" && i + 1 < argc)
+			vec_envs = std::atol(argv[++i]);
+		else if (arg == "--threads" && i + 1 < argc)
+			threads = std::atol(argv[++i]);
+		else if (arg == "--checkpoint" && i + 1 < argc)
+			checkpoint = argv[++i];
+		else if (arg == "--features" && i + 1 < argc)
+			features = std::atol(argv[++i]);
+		else if (arg == "--movegen" && i + 1 < argc)
+			movegen = std::atol(argv[++i]);
+		else if (arg == "--placements" && i + 1 < argc)
+			placements = std::atol(argv[++i]);
+		else if (arg == "--history" && i + 1 < argc)
+			history_pieces = std::atol(argv[++i]);
+		else if (arg == "--search" && i + 1 < argc)
+			search = std::atol(argv[++i]);
+		else if (arg == "--depth" && i + 1 < argc)
+			search_options.depth = std::atoi(argv[++i]);
+		else if (arg == "--preview" && i + 1 < argc)
+			search_options.preview = std::atoi(argv[++i]);
+		else if (arg == "--budget-us" && i + 1 < argc)
+			search_options.budget = std::chrono::microseconds(std::atol(argv[++i]));
+		else {
+			std::cerr << "usage: " << argv[0]
+			          << " [--ticks N] [--budget N] [--perf] [--json]"
+			          << " [--vec-env N [--threads N] [--checkpoint FILE]] [--features N]"
+			          << " [--movegen N] [--placements N] [--history N]"
+			          << " [--search N [--depth N] [--preview N] [--budget-us N]]\n";
+			return 2;
+		}
+	}
+
+	if (vec_envs)
+		return bench_vec_env(vec_envs, threads, ticks, checkpoint);
+
+	if (features)
+		return bench_features(features, ticks / 1000 + 1);
+
+	if (movegen)
+		return bench_movegen(movegen);
+
+	if (placements)
+		return bench_placements(placements);
+
+	if (history_pieces)
+		return bench_history(history_pieces);
+
+	if (search)
+		return bench_search(search, search_options);
+
+	if (!alloc_stats::enabled)
+		std::cerr << "warning: built without TETRIS_ALLOC_STATS, "
+		          << "allocation counts will read zero\n";
+
+	perf::group pmu;
+	if (use_perf && !pmu.ok())
+		std::cerr << "warning: no hardware counters available\n";
+
+	perf::group const *counters = use_perf && pmu.ok() ? &pmu : nullptr;
+
+	call_stats move_left{"move_left"};
+	call_stats move_right{"move_right"};
+	call_stats rotate{"rotate"};
+	call_stats ghost{"ghost_y"};
+	call_stats copy{"board copy"};
+	call_stats fall{"update (fall)"};
+	call_stats spawn{"update (spawn)"};
+	call_stats lock{"update (lock)"};
+	call_stats snapshot{"history record"};
+	call_stats undo{"history rewind"};
+	call_stats whole{"whole tick"};
+
+	call_stats *all[] = {
+		&move_left, &move_right, &rotate, &ghost, &copy, &fall, &spawn, &lock,
+		&snapshot, &undo, &whole
+	};
+
+	game::engine eng{15, 19};
+	eng.reset();
+
+	game::board_history history{eng, 64};
+
+	decltype(eng.board) shadow;
+	long pieces = 0;
+
+	// the first ticks warm up the board copy and the spare pieces
+	const long warmup = 100;
+
+	for(long tick = 0; tick < ticks + warmup; ++tick) {
+		bool record = tick >= warmup;
+		auto run = [&](call_stats& st, auto&& f) {
+			if (record)
+				st.measure(f, counters);
+			else
+				f();
+		};
+
+		auto body = [&] {
+			// steer each piece towards a column that walks across the
+			// board from piece to piece, rotating now and then
+			if (eng.active_piece) {
+				auto& ap = eng.active_piece;
+				int target = (pieces * 5) % eng.width;
+
+				// stand I pieces up and send them down the well
+				if (ap->id == 'i')
+					target = well_x;
+
+				if (ap->id == 'i' && ap->blocks[0].second == 0)
+					run(rotate, [&] { eng.rotate(); });
+				else if (ap->orig_x > target)
+					run(move_left, [&] { eng.move_left(); });
+				else if (ap->orig_x < target)
+					run(move_right, [&] { eng.move_right(); });
+				else if (tick % 4 == 0)
+					run(rotate, [&] { eng.rotate(); });
+			}
+
+			run(ghost, [&] { eng.ghost_y(); });
+			run(copy, [&] { shadow = eng.board; });
+
+			keep_alive(eng);
+
+			bool spawning = !eng.active_piece;
+			game::cleared_rows cleared;
+
+			auto update = [&] { cleared = eng.update(); };
+
+			if (spawning) {
+				run(spawn, update);
+				++pieces;
+
+				// snapshot every piece, now and then take back the last few
+				if (pieces % 50 == 0)
+					run(undo, [&] { history.rewind(3); });
+				else if (eng.active_piece)
+					run(snapshot, [&] { history.record(); });
+			}
+			else if (record) {
+				// whether the piece locked is only known afterwards
+				call_stats probe{""};
+				probe.measure(update, counters);
+
+				(eng.active_piece ? fall : lock).add(probe);
+			} else
+				update();
+		};
+
+		run(whole, body);
+	}
+
+	bool over_budget = false;
+
+	for(auto st : all)
+		if (st->worst_allocs > budget) {
+			std::cerr << st->name << ": " << st->worst_allocs
+			          << " allocations in one call, budget is " << budget << "\n";
+			over_budget = true;
+		}
+
+	if (json) {
+		std::cout << "{\n  \"ticks\": " << ticks
+		          << ",\n  \"width\": " << eng.width
+		          << ",\n  \"height\": " << eng.height
+		          << ",\n  \"score\": " << eng.score
+		          << ",\n  \"calls\": [";
+
+		const char *sep = "\n";
+		for(auto st : all) {
+			std::cout << sep << "    {\"name\": \"" << st->name << "\""
+			          << ", \"calls\": " << st->calls
+			          << ", \"ns\": " << st->time.count()
+			          << ", \"allocs\": " << st->allocs.allocs
+			          << ", \"bytes\": " << st->allocs.bytes
+			          << ", \"worst_allocs\": " << st->worst_allocs
+			          << ", \"perf\": ";
+			if (counters)
+				pmu.write_json(std::cout, st->counters);
+			else
+				std::cout << "null";
+			std::cout << "}";
+			sep = ",\n";
+		}
+
+		std::cout << "\n  ]\n}\n";
+
+		return over_budget ? 1 : 0;
+	}
+
+	std::cout << std::left << std::setw(16) << "call"
+	          << std::right << std::setw(10) << "calls"
+	          << std::setw(10) << "ns/call"
+	          << std::setw(12) << "allocs/call"
+	          << std::setw(12) << "bytes/call"
+	          << std::setw(8) << "worst";
+	if (counters)
+		std::cout << std::setw(12) << "cycles/call"
+		          << std::setw(12) << "ins/call"
+		          << std::setw(12) << "brmiss/call";
+	std::cout << "\n";
+
+	for(auto st : all) {
+		double n = st->calls ? st->calls : 1;
+
+		std::cout << std::left << std::setw(16) << st->name
+		          << std::right << std::setw(10) << st->calls
+		          << std::setw(10) << std::fixed << std::setprecision(1)
+		          << st->time.count() / n
+		          << std::setw(12) << std::setprecision(3) << st->allocs.allocs / n
+		          << std::setw(12) << std::setprecision(1) << st->allocs.bytes / n
+		          << std::setw(8) << st->worst_allocs;
+		if (counters)
+			std::cout << std::setw(12) << st->counters.v[perf::cycles] / n
+			          << std::setw(12) << st->counters.v[perf::instructions] / n
+			          << std::setw(12) << std::setprecision(3)
+			          << st->counters.v[perf::branch_misses] / n;
+		std::cout << "\n";
+	}
+
+	std::cout << "score " << eng.score << "\n";
+
+	return over_budget ? 1 : 0;
+}
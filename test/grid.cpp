@@ -0,0 +1,150 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <final/final.h>
+
+#include "asciicast.h"
+#include "data_grid.h"
+#include "layout_pass.h"
+
+namespace fc = finalcut;
+
+class GridDialog : public fc::FDialog
+{
+	DataGrid table;
+	fc::FLabel status{this};
+	layout_pass layout{*this};
+
+public:
+	GridDialog(fc::FWidget& widget, std::uint64_t rows)
+		: FDialog(&widget)
+		, table(this, grid::sample_columns(), grid::sample_source())
+	{
+		setText("Grid");
+		setPos(fc::FPoint(2, 1));
+		setSize(fc::FSize(66, 24));
+
+		setMinimumSize({20, 6});
+		setResizeable();
+
+		layout.place(table, [](std::size_t w, std::size_t h) {
+			return layout_pass::box{1, 1, w, h > 1 ? h - 1 : 1};
+		});
+		layout.place(status, [](std::size_t w, std::size_t h) {
+			return layout_pass::box{1, int(h), w, 1};
+		});
+		layout.run();
+
+		table.setRows(rows);
+		updateStatus();
+	}
+
+	void onKeyPress(fc::FKeyEvent *ev) override
+	{
+		auto page = std::int64_t(table.pageRows());
+
+		switch(ev->key()) {
+		case fc::fc::Fkey_up:
+			table.scroll(-1);
+			break;
+
+		case fc::fc::Fkey_down:
+			table.scroll(1);
+			break;
+
+		case fc::fc::Fkey_page_up:
+			table.scroll(-page);
+			break;
+
+		case fc::fc::Fkey_page_down:
+			table.scroll(page);
+			break;
+
+		case fc::fc::Fkey_home:
+			table.scrollTo(0);
+			break;
+
+		case fc::fc::Fkey_end:
+			table.scrollTo(table.view().rows());
+			break;
+
+		case 'j':
+			// somewhere far down, to show it costs the same as a line
+			table.scrollTo(table.view().top() + table.view().rows() / 7);
+			break;
+
+		default:
+			fc::FDialog::onKeyPress(ev);
+			return;
+		}
+
+		ev->accept();
+		updateStatus();
+	}
+
+	void adjustSize() override
+	{
+		fc::FDialog::adjustSize();
+		layout.invalidate();
+	}
+
+	void onTimer(fc::FTimerEvent *ev) override
+	{
+		if (layout.timer(ev))
+			updateStatus();
+	}
+
+private:
+	void updateStatus()
+	{
+		auto const& v = table.view();
+		auto const& cache = v.rows_cached();
+
+		fc::FString s;
+		s.sprintf("rows %llu-%llu of %llu, cache %llu hits %llu misses",
+		          (unsigned long long)v.top(),
+		          (unsigned long long)(v.top() + v.height()),
+		          (unsigned long long)v.rows(),
+		          (unsigned long long)cache.hits(),
+		          (unsigned long long)cache.misses());
+		status.setText(s);
+		status.redraw();
+	}
+};
+
+// grid [--rows N] [--record FILE]
+//
+// A made-up table of N rows (100 million by default) in a dialog; up,
+// down, page up/down, home and end scroll it and j jumps a seventh of
+// the table ahead.  --record writes the session to FILE in asciicast
+// format (see asciicast.h).
+int main(int argc, char **argv)
+{
+	std::uint64_t rows = 100000000;
+
+	auto session = asciicast::from_args(argc, argv);
+	if (session && !session->ok()) {
+		std::cerr << "cannot record to " << session->path() << "\n";
+		return 2;
+	}
+
+	int out = 1;
+	for(int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--rows") == 0 && i + 1 < argc)
+			rows = std::strtoull(argv[++i], nullptr, 10);
+		else
+			argv[out++] = argv[i];
+	}
+	argc = out;
+
+	fc::FApplication app{argc, argv};
+	GridDialog dialog{app, rows};
+	app.setMainWidget(&dialog);
+
+	dialog.show();
+
+	return app.exec();
+}
@@ -0,0 +1,212 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "grid_view.h"
+#include "proc_stats.h"
+
+// Frame-time benchmark of the virtualized table (grid_view.h) over
+// tables from a thousand to a hundred million rows.  A frame is what
+// DataGrid::draw() does with the view: format or fetch every visible row
+// and copy it out, here into a screen buffer instead of the terminal.
+//
+//   grid_bench [--sizes N,...] [--height N] [--cache N] [--frames N]
+//              [--seed N] [--json]
+//
+// For each size three runs of --frames frames are timed: scrolling a
+// line at a time, a page at a time, and jumping to random rows.  Each
+// reports the median, 99th percentile and worst frame, the share of
+// rows found in the cache, and the resident memory after the run.
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+struct run_stats
+{
+	char const *name;
+	double p50_us{0}, p99_us{0}, max_us{0};
+	double hit_rate{0};
+};
+
+struct size_stats
+{
+	std::uint64_t rows;
+	std::vector<run_stats> runs;
+	long rss_kb;
+};
+
+std::vector<std::uint64_t> parse_sizes(std::string const& list)
+{
+	std::vector<std::uint64_t> out;
+	std::size_t pos = 0;
+
+	while(pos < list.size()) {
+		auto end = list.find(',', pos);
+		if (end == std::string::npos)
+			end = list.size();
+		out.push_back(std::strtoull(list.c_str() + pos, nullptr, 10));
+		pos = end + 1;
+	}
+
+	return out;
+}
+
+// step(view) moves the view before each frame
+template <typename Step>
+run_stats run(char const *name, grid::view& v, int frames, std::string& screen, Step step)
+{
+	std::vector<double> us;
+	us.reserve(frames);
+
+	auto hits = v.rows_cached().hits();
+	auto misses = v.rows_cached().misses();
+
+	for(int f = 0; f < frames; ++f) {
+		step(v);
+
+		auto t0 = clock::now();
+		screen.clear();
+		v.visible([&](std::size_t, std::uint64_t, std::string const& line) {
+			screen += line;
+			screen += '\n';
+		});
+		us.push_back(std::chrono::duration<double, std::micro>(clock::now() - t0).count());
+	}
+
+	std::sort(us.begin(), us.end());
+
+	run_stats r;
+	r.name = name;
+	r.p50_us = us[us.size() / 2];
+	r.p99_us = us[us.size() * 99 / 100];
+	r.max_us = us.back();
+
+	double h = v.rows_cached().hits() - hits;
+	double m = v.rows_cached().misses() - misses;
+	r.hit_rate = h + m > 0 ? h / (h + m) : 0;
+
+	return r;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<std::uint64_t> sizes{1000, 100000, 10000000, 100000000};
+	std::size_t height = 50;
+	std::size_t cache = 1024;
+	int frames = 2000;
+	unsigned seed = 1;
+	bool json = false;
+
+	for(int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+
+		if (arg == "--sizes" && i + 1 < argc)
+			sizes = parse_sizes(argv[++i]);
+		else if (arg == "--height" && i + 1 < argc)
+			height = std::atol(argv[++i]);
+		else if (arg == "--cache" && i + 1 < argc)
+			cache = std::atol(argv[++i]);
+		else if (arg == "--frames" && i + 1 < argc)
+			frames = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--seed" && i + 1 < argc)
+			seed = std::atoi(argv[++i]);
+		else if (arg == "--json")
+			json = true;
+		else {
+			std::cerr << "usage: " << argv[0]
+			          << " [--sizes N,...] [--height N] [--cache N] [--frames N]"
+			          << " [--seed N] [--json]\n";
+			return 2;
+		}
+	}
+
+	std::vector<size_stats> results;
+	std::string screen;
+
+	for(auto rows : sizes) {
+		grid::view v(grid::sample_columns(), grid::sample_source(), cache);
+		v.set_rows(rows);
+		v.resize(height);
+
+		std::mt19937_64 rng(seed);
+		auto page = std::int64_t(height);
+
+		size_stats s;
+		s.rows = rows;
+
+		// back and forth over a few pages, as someone reading would
+		long n = 0;
+		s.runs.push_back(run("line", v, frames, screen, [&](grid::view& v) {
+			v.scroll(n++ / (4 * page) % 2 ? -1 : 1);
+		}));
+
+		n = 0;
+		s.runs.push_back(run("page", v, frames, screen, [&](grid::view& v) {
+			v.scroll(n++ / 8 % 2 ? -page : page);
+		}));
+
+		s.runs.push_back(run("jump", v, frames, screen, [&](grid::view& v) {
+			v.scroll_to(rows ? rng() % rows : 0);
+		}));
+
+		s.rss_kb = procstats::rss_kb();
+		results.push_back(s);
+	}
+
+	if (json) {
+		std::cout << "{\n  \"height\": " << height
+		          << ",\n  \"cache\": " << cache
+		          << ",\n  \"frames\": " << frames
+		          << ",\n  \"sizes\": [";
+
+		char const *sep = "\n";
+		for(auto const& s : results) {
+			std::cout << sep << "    {\"rows\": " << s.rows
+			          << ", \"rss_kb\": " << s.rss_kb << ", \"runs\": [";
+			char const *rsep = "";
+			for(auto const& r : s.runs) {
+				std::cout << rsep << "{\"name\": \"" << r.name << "\""
+				          << ", \"p50_us\": " << r.p50_us
+				          << ", \"p99_us\": " << r.p99_us
+				          << ", \"max_us\": " << r.max_us
+				          << ", \"hit_rate\": " << r.hit_rate << "}";
+				rsep = ", ";
+			}
+			std::cout << "]}";
+			sep = ",\n";
+		}
+
+		std::cout << "\n  ]\n}\n";
+		return 0;
+	}
+
+	std::cout << std::right << std::setw(11) << "rows"
+	          << std::setw(6) << "run"
+	          << std::setw(10) << "p50 us"
+	          << std::setw(10) << "p99 us"
+	          << std::setw(10) << "max us"
+	          << std::setw(8) << "hits"
+	          << std::setw(10) << "rss kB" << "\n";
+
+	for(auto const& s : results)
+		for(auto const& r : s.runs)
+			std::cout << std::setw(11) << s.rows
+			          << std::setw(6) << r.name
+			          << std::fixed << std::setprecision(1)
+			          << std::setw(10) << r.p50_us
+			          << std::setw(10) << r.p99_us
+			          << std::setw(10) << r.max_us
+			          << std::setw(7) << std::setprecision(0) << r.hit_rate * 100 << "%"
+			          << std::setw(10) << s.rss_kb << "\n";
+
+	return 0;
+}
@@ -0,0 +1,364 @@
+#ifndef GRID_VIEW_H
+#define GRID_VIEW_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A window onto a table of any number of rows that only ever asks its
+// source for the rows it shows.  Rows are formatted into fixed-width
+// lines once and kept in an LRU cache of a fixed number of rows, so
+// scrolling costs the visible rows and memory does not grow with the
+// table.  No terminal code here, DataGrid (data_grid.h) draws it.
+namespace grid {
+
+struct column
+{
+	std::string title;
+	std::size_t width;
+};
+
+// Appends the text of cell (row, col) to out
+using source = std::function<void(std::uint64_t row, std::size_t col, std::string& out)>;
+
+// Appends s cut or padded to width columns; a column is a UTF-8 code
+// point
+inline void append_cell(std::string& out, std::string const& s, std::size_t width)
+{
+	std::size_t cols = 0, i = 0;
+	for(; i < s.size(); ++i)
+		if ((static_cast<unsigned char>(s[i]) & 0xc0) != 0x80 && cols++ == width)
+			break;
+
+	out.append(s, 0, i);
+	out.append(width - std::min(cols, width), ' ');
+}
+
+// Formatted rows by row number, the least recently used dropped when
+// full.  Slots and their strings are reused, so once every slot has held
+// a row of the longest length nothing more is allocated.
+class row_cache
+{
+public:
+	explicit row_cache(std::size_t capacity)
+		: slots(std::max<std::size_t>(capacity, 1))
+	{
+		std::size_t n = 1;
+		while(n < 2 * slots.size())
+			n <<= 1;
+		table.assign(n, none);
+
+		clear();
+	}
+
+	std::size_t capacity() const
+	{
+		return slots.size();
+	}
+
+	// The row, now the most recently used, or null
+	std::string const *find(std::uint64_t row)
+	{
+		auto i = lookup(row);
+		if (i == none) {
+			++missed;
+			return nullptr;
+		}
+
+		++hit;
+		unlink(i);
+		push_front(i);
+		return &slots[i].text;
+	}
+
+	// An empty string to format row into, in place of the least recently
+	// used; the row must not be cached already
+	std::string& insert(std::uint64_t row)
+	{
+		auto i = slots[head].prev;   // the last one
+		if (slots[i].used)
+			erase(slots[i].row);
+
+		slots[i].row = row;
+		slots[i].used = true;
+		slots[i].text.clear();
+		add(row, i);
+
+		unlink(i);
+		push_front(i);
+		return slots[i].text;
+	}
+
+	void clear()
+	{
+		std::fill(table.begin(), table.end(), none);
+		for(std::uint32_t i = 0; i < slots.size(); ++i) {
+			slots[i].used = false;
+			slots[i].prev = i ? i - 1 : std::uint32_t(slots.size() - 1);
+			slots[i].next = i + 1 < slots.size() ? i + 1 : 0;
+		}
+		head = 0;
+	}
+
+	std::uint64_t hits() const
+	{
+		return hit;
+	}
+
+	std::uint64_t misses() const
+	{
+		return missed;
+	}
+
+private:
+	static constexpr std::uint32_t none = ~0u;
+
+	struct slot
+	{
+		std::uint64_t row{0};
+		std::uint32_t prev{0}, next{0};
+		bool used{false};
+		std::string text;
+	};
+
+	// a ring in use order starting at head; unused slots sit at the end
+	std::vector<slot> slots;
+	std::uint32_t head{0};
+
+	// slot of each cached row, open addressing with linear probing
+	std::vector<std::uint32_t> table;
+
+	std::uint64_t hit{0}, missed{0};
+
+	std::size_t home(std::uint64_t row) const
+	{
+		return (row * 0x9e3779b97f4a7c15ull >> 32) & (table.size() - 1);
+	}
+
+	std::uint32_t lookup(std::uint64_t row) const
+	{
+		for(auto p = home(row); ; p = (p + 1) & (table.size() - 1)) {
+			auto i = table[p];
+			if (i == none || slots[i].row == row)
+				return i;
+		}
+	}
+
+	void add(std::uint64_t row, std::uint32_t i)
+	{
+		auto p = home(row);
+		while(table[p] != none)
+			p = (p + 1) & (table.size() - 1);
+		table[p] = i;
+	}
+
+	// without tombstones: later entries of the probe run move back
+	void erase(std::uint64_t row)
+	{
+		auto mask = table.size() - 1;
+		auto p = home(row);
+		while(slots[table[p]].row != row)
+			p = (p + 1) & mask;
+
+		for(auto q = (p + 1) & mask; table[q] != none; q = (q + 1) & mask) {
+			auto h = home(slots[table[q]].row);
+			// q's entry may fill p unless its home lies in (p, q]
+			if (((q - h) & mask) >= ((q - p) & mask)) {
+				table[p] = table[q];
+				p = q;
+			}
+		}
+		table[p] = none;
+	}
+
+	void unlink(std::uint32_t i)
+	{
+		if (i == head) {
+			head = slots[i].next;
+			if (head == i)
+				return;
+		}
+		slots[slots[i].prev].next = slots[i].next;
+		slots[slots[i].next].prev = slots[i].prev;
+	}
+
+	void push_front(std::uint32_t i)
+	{
+		if (slots[i].next == i && head == i)
+			return;
+
+		auto last = slots[head].prev;
+		slots[i].next = head;
+		slots[i].prev = last;
+		slots[last].next = i;
+		slots[head].prev = i;
+		head = i;
+	}
+};
+
+class view
+{
+public:
+	// cache_rows is the memory bound; a few screens' worth keeps
+	// scrolling back and forth from going to the source
+	view(std::vector<column> c, source s, std::size_t cache_rows = 1024)
+		: cols(std::move(c))
+		, src(std::move(s))
+		, cache(cache_rows)
+	{
+		for(auto const& col : cols) {
+			if (!head.empty())
+				head += ' ';
+			append_cell(head, col.title, col.width);
+		}
+	}
+
+	std::vector<column> const& columns() const
+	{
+		return cols;
+	}
+
+	// Line of column titles, as wide as every row
+	std::string const& header() const
+	{
+		return head;
+	}
+
+	std::uint64_t rows() const
+	{
+		return count;
+	}
+
+	// The table now has n rows; the view stays where it was if it can
+	void set_rows(std::uint64_t n)
+	{
+		count = n;
+		scroll_to(first);
+	}
+
+	// Rows of the table are different now, format them again
+	void invalidate()
+	{
+		cache.clear();
+	}
+
+	// Rows shown at a time
+	std::size_t height() const
+	{
+		return shown;
+	}
+
+	void resize(std::size_t h)
+	{
+		shown = h;
+		scroll_to(first);
+	}
+
+	// First row shown
+	std::uint64_t top() const
+	{
+		return first;
+	}
+
+	void scroll(std::int64_t n)
+	{
+		if (n < 0 && std::uint64_t(-n) > first)
+			scroll_to(0);
+		else
+			scroll_to(first + n);
+	}
+
+	void scroll_to(std::uint64_t row)
+	{
+		auto last = count > shown ? count - shown : 0;
+		first = std::min(row, last);
+	}
+
+	// Row row formatted, from the cache or the source
+	std::string const& line(std::uint64_t row)
+	{
+		if (auto const *s = cache.find(row))
+			return *s;
+
+		auto& out = cache.insert(row);
+		for(std::size_t c = 0; c < cols.size(); ++c) {
+			cell.clear();
+			src(row, c, cell);
+			if (c)
+				out += ' ';
+			append_cell(out, cell, cols[c].width);
+		}
+		return out;
+	}
+
+	// f(i, row, line) for the i-th visible row
+	template <typename F>
+	void visible(F&& f)
+	{
+		for(std::size_t i = 0; i < shown && first + i < count; ++i)
+			f(i, first + i, line(first + i));
+	}
+
+	row_cache const& rows_cached() const
+	{
+		return cache;
+	}
+
+private:
+	std::vector<column> cols;
+	source src;
+	row_cache cache;
+	std::string head;
+	std::string cell;
+
+	std::uint64_t count{0};
+	std::uint64_t first{0};
+	std::size_t shown{0};
+};
+
+// A made-up table of any size for the grid example and grid_bench: every
+// cell is worked out from its row number, so it costs no memory
+inline std::vector<column> sample_columns()
+{
+	return {{"row", 11}, {"name", 10}, {"value", 12}, {"hash", 16}, {"state", 7}};
+}
+
+inline source sample_source()
+{
+	return [](std::uint64_t row, std::size_t col, std::string& out) {
+		static char const *const syllables[] = {"ka", "lo", "mi", "ne", "ru", "sa", "ti", "vo"};
+		static char const *const states[] = {"idle", "busy", "done", "failed"};
+
+		auto h = (row + 1) * 0x9e3779b97f4a7c15ull;
+		h ^= h >> 29;
+		char buf[24];
+
+		switch(col) {
+		case 0:
+			out += std::to_string(row);
+			break;
+		case 1:
+			for(int i = 0; i < 4; ++i)
+				out += syllables[h >> (8 * i) & 7];
+			break;
+		case 2:
+			std::snprintf(buf, sizeof(buf), "%12.3f", double(h % 10000000) / 1000);
+			out += buf;
+			break;
+		case 3:
+			std::snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)h);
+			out += buf;
+			break;
+		default:
+			out += states[h >> 60 & 3];
+		}
+	};
+}
+
+}
+
+#endif // GRID_VIEW_H
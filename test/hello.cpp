@@ -1,7 +1,21 @@
 #include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <fcntl.h>
 
 #include <final/final.h>
 
+#include "asciicast.h"
+#include "draw_stats.h"
+#include "idle_timer.h"
+#include "layout_pass.h"
+#include "log_tail.h"
+#include "stats_panel.h"
+
 namespace fc = finalcut;
 
 class HelloDialog : public fc::FDialog
@@ -9,6 +23,24 @@ class HelloDialog : public fc::FDialog
 	fc::FLabel labelDim{this};
 	fc::FLabel labelPos{this};
 
+	// resource use of a process, and a log below it fed by source; the
+	// frame timer runs at frame rate for it while lines come in and the
+	// dots after the dimensions move every third tick, wrapping instead
+	// of growing.  Without new lines the timer backs off to a second,
+	// and stays there while the dialog is hidden, only to keep the
+	// source from waiting.
+	StatsPanel stats{this};
+	LogTail tail{this};
+	std::unique_ptr<logtail::line_source> source;
+
+	static constexpr int frame_ms = 33;
+	idle_timer frames{*this, frame_ms, 1000, 1000};
+	int ticks = 0;
+	fc::FString dimensions;
+
+	// after the widgets it places
+	layout_pass layout{*this};
+
 public:
 	HelloDialog(fc::FWidget& widget)
 		: FDialog(&widget)
@@ -37,7 +69,36 @@ public:
 
 		updateLabel();
 
-		addTimer(100);
+		layout.place(labelDim, [](std::size_t w, std::size_t) {
+			return layout_pass::box{3, 2, w, 1};
+		});
+		layout.place(stats, [](std::size_t w, std::size_t) {
+			return layout_pass::box{2, 5, w > 2 ? w - 2 : 1, 4};
+		});
+		layout.place(tail, [](std::size_t w, std::size_t h) {
+			return layout_pass::box{2, 10, w > 2 ? w - 2 : 1, h > 10 ? h - 10 : 1};
+		});
+		layout.run();
+
+		frames.start();
+	}
+
+	// Show lines read from fd, e.g. a pipe, or else per_second lines of
+	// ticker
+	void startTail(int fd, double per_second)
+	{
+		source.reset();
+		if (fd >= 0)
+			source = std::make_unique<logtail::line_source>(tail.queue(), fd);
+		else
+			source = std::make_unique<logtail::line_source>(tail.queue(), per_second);
+	}
+
+	// Show the resource use of pid, 0 for ourselves, sampled every
+	// interval_ms
+	bool watch(pid_t pid, int interval_ms)
+	{
+		return stats.watch(pid, interval_ms);
 	}
 
 	void updateLabel()
@@ -49,6 +110,7 @@ public:
 
 		l.sprintf("Dimensions: %d x %d", width, height);
 
+		dimensions = l;
 		labelDim.setText(l);
 
 		auto x = getX();
@@ -62,6 +124,8 @@ public:
 
 	void onKeyPress(fc::FKeyEvent *ev) override
 	{
+		frames.busy();
+
 		auto key = ev->key();
 		switch(key) {
 		case fc::fc::Fkey_escape:
@@ -73,6 +137,26 @@ public:
 			redraw();
 			break;
 
+		case fc::fc::Fkey_up:
+			tail.scroll(1);
+			break;
+
+		case fc::fc::Fkey_down:
+			tail.scroll(-1);
+			break;
+
+		case fc::fc::Fkey_page_up:
+			tail.scroll(long(tail.getHeight()));
+			break;
+
+		case fc::fc::Fkey_page_down:
+			tail.scroll(-long(tail.getHeight()));
+			break;
+
+		case fc::fc::Fkey_end:
+			tail.scroll(-long(tail.count()));
+			break;
+
 		default:
 			fc::FDialog::onKeyPress(ev);
 			break;
@@ -84,20 +168,57 @@ public:
 	{
 		fc::FDialog::adjustSize();
 
-		labelDim.setSize({getClientWidth(), getClientHeight()});
+		// the children follow in one pass a frame
+		layout.invalidate();
 
 		//updateLabel();
 	}
 
+	void draw() override
+	{
+		draw_stats::timer timing;
+
+		fc::FDialog::draw();
+	}
+
 	void onTimer (fc::FTimerEvent *ev) override
 	{
-		labelDim << ".";
+		if (layout.timer(ev) || !frames.is(ev))
+			return;
+
+		// the log repaints its own rows that changed; the dots alone do
+		// not keep the timer at full rate
+		frames.tick(tail.poll() > 0);
+
+		if (++ticks % 3 || frames.inBackground())
+			return;
+
+		fc::FString l{dimensions};
+		for(int i = 0; i < ticks / 3 % 4; ++i)
+			l << ".";
+		labelDim.setText(l);
+		labelDim.redraw();
+	}
+
+	void onShow(fc::FShowEvent *ev) override
+	{
+		frames.background(false);
+		fc::FDialog::onShow(ev);
+	}
 
-		redraw();
+	void onHide(fc::FHideEvent *ev) override
+	{
+		frames.background(true);
+		fc::FDialog::onHide(ev);
 	}
 
+	// Every resize event sends the same text
 	void setChildText(fc::FString const& str)
 	{
+		if (str == dimensions)
+			return;
+
+		dimensions = str;
 		labelDim.setText(str);
 	}
 };
@@ -121,6 +242,11 @@ public:
 		hello.show();
 	}
 
+	HelloDialog& dialog()
+	{
+		return hello;
+	}
+
 	void onResize(fc::FResizeEvent *ev) override
 	{
 		hello.setChildText("for the glory of terran");
@@ -130,9 +256,55 @@ public:
 };
 
 
+// hello [--pid N] [--interval MS] [--tail FILE] [--rate N] [--record FILE]
+//
+// The dialog shows the CPU, memory, context switches and I/O of process
+// N (hello itself by default) sampled every MS milliseconds (1000), and
+// below them a log of the lines read from FILE, e.g. a named pipe,
+// or else of a ticker writing N lines a second (10 by default); up/down,
+// page up/down scroll it and end follows the tail again.  --record
+// writes the session to FILE in asciicast format (see asciicast.h).
 int main(int argc, char **argv)
 {
+	std::string tail;
+	double rate = 10;
+	pid_t pid = 0;
+	int interval = 1000;
+
+	auto session = asciicast::from_args(argc, argv);
+	if (session && !session->ok()) {
+		std::cerr << "cannot record to " << session->path() << "\n";
+		return 2;
+	}
+
+	int out = 1;
+	for(int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--tail") == 0 && i + 1 < argc)
+			tail = argv[++i];
+		else if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+			rate = std::atof(argv[++i]);
+		else if (std::strcmp(argv[i], "--pid") == 0 && i + 1 < argc)
+			pid = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--interval") == 0 && i + 1 < argc)
+			interval = std::max(10, std::atoi(argv[++i]));
+		else
+			argv[out++] = argv[i];
+	}
+	argc = out;
+
+	int fd = -1;
+	if (!tail.empty() && (fd = open(tail.c_str(), O_RDONLY)) < 0) {
+		std::cerr << "cannot open " << tail << "\n";
+		return 2;
+	}
+
 	HelloApplication app{argc, argv};
+	app.dialog().startTail(fd, rate);
+
+	if (!app.dialog().watch(pid, interval)) {
+		std::cerr << "cannot read /proc/" << pid << "\n";
+		return 2;
+	}
 
 	return app.exec();
 }
@@ -0,0 +1,238 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "snapshot.h"
+#include "tetris_engine.h"
+
+namespace game {
+
+// Undo history of one engine that shares unchanged rows between states.
+//
+// Row contents live in a pool of reference counted slots, and a recorded
+// state is one slot number per row plus the pieces and counters.
+// record() copies only the rows the engine marked in dirty_rows and
+// shares the others with the state before it; rewind() copies back only
+// the rows that differ from what the engine holds.  Beyond capacity the
+// oldest states are dropped and their slots reused, so a long game runs
+// in fixed memory, reserved up front.
+//
+// restore_into() puts a past state into another engine of the same size,
+// to branch off from it without touching the game.
+class board_history
+{
+public:
+	explicit board_history(engine& e, std::size_t cap = 256)
+		: eng(e)
+		, capacity(std::max<std::size_t>(cap, 2))
+		, states(capacity)
+	{
+		clear();
+	}
+
+	board_history(board_history const&) = delete;
+	board_history& operator=(board_history const&) = delete;
+
+	std::size_t size() const
+	{
+		return count;
+	}
+
+	// Forget all states, for an engine that was loaded or resized
+	void clear()
+	{
+		width = eng.width;
+		height = eng.height;
+		first = count = 0;
+
+		rows.assign(capacity * height, 0);
+		shown.assign(height, 0);
+		refs.clear();
+		free_slots.clear();
+		cells.clear();
+
+		// every state has at most height rows of its own
+		refs.reserve(capacity * height);
+		free_slots.reserve(capacity * height);
+		cells.reserve(capacity * height * width);
+
+		eng.dirty_rows = ~0ull;
+	}
+
+	// Save the engine's state as the newest one
+	void record()
+	{
+		if (count == capacity)
+			drop(first);
+
+		auto const *prev = count ? row_ids(newest()) : nullptr;
+		auto at = (first + count) % capacity;
+		auto *ids = row_ids(at);
+
+		for(std::size_t y = 0; y < height; ++y) {
+			if (prev && !((eng.dirty_rows >> y) & 1)) {
+				ids[y] = prev[y];
+				++refs[ids[y]];
+			} else {
+				ids[y] = store(eng.board[y]);
+			}
+			shown[y] = ids[y];
+		}
+
+		save(states[at], eng);
+		eng.dirty_rows = 0;
+		++count;
+	}
+
+	// Drop the n newest states, keeping the oldest, and put the engine
+	// back into the newest one left; n = 0 just returns to the newest.
+	// Returns the number of states dropped.
+	std::size_t rewind(std::size_t n = 1)
+	{
+		if (count == 0)
+			return 0;
+
+		n = std::min(n, count - 1);
+		for(std::size_t i = 0; i < n; ++i)
+			drop(newest());
+
+		auto const *ids = row_ids(newest());
+		for(std::size_t y = 0; y < height; ++y)
+			if (((eng.dirty_rows >> y) & 1) || shown[y] != ids[y]) {
+				load_row(ids[y], eng.board[y]);
+				shown[y] = ids[y];
+			}
+
+		load(states[newest()], eng);
+		eng.dirty_rows = 0;
+
+		return n;
+	}
+
+	// Copy the state back states before the newest into other
+	void restore_into(engine& other, std::size_t back = 0) const
+	{
+		if (back >= count)
+			return;
+
+		auto at = (first + count - 1 - back) % capacity;
+		auto const *ids = row_ids(at);
+
+		other.reset();
+		for(std::size_t y = 0; y < height; ++y)
+			load_row(ids[y], other.board[y]);
+
+		load(states[at], other);
+		other.dirty_rows = ~0ull;
+	}
+
+private:
+	struct state
+	{
+		int score{0};
+		int drop_height{0};
+		std::uint32_t piece_state{0};
+		bool game_over{false};
+		piece_record active, next;
+	};
+
+	engine& eng;
+	std::size_t width{0}, height{0}, capacity;
+
+	// ring of states, oldest at first, and their row slots
+	std::vector<state> states;
+	std::vector<std::uint32_t> rows;
+	std::size_t first{0}, count{0};
+
+	// row pool
+	std::vector<int> cells;
+	std::vector<std::uint32_t> refs;
+	std::vector<std::uint32_t> free_slots;
+
+	// slot each engine row held when it was last recorded or rewound
+	std::vector<std::uint32_t> shown;
+
+	std::size_t newest() const
+	{
+		return (first + count - 1) % capacity;
+	}
+
+	std::uint32_t *row_ids(std::size_t at)
+	{
+		return rows.data() + at * height;
+	}
+
+	std::uint32_t const *row_ids(std::size_t at) const
+	{
+		return rows.data() + at * height;
+	}
+
+	std::uint32_t store(std::vector<int> const& row)
+	{
+		std::uint32_t slot;
+
+		if (free_slots.empty()) {
+			slot = refs.size();
+			refs.push_back(0);
+			cells.resize(cells.size() + width);
+		} else {
+			slot = free_slots.back();
+			free_slots.pop_back();
+		}
+
+		std::copy(row.begin(), row.begin() + width, cells.begin() + slot * width);
+		refs[slot] = 1;
+
+		return slot;
+	}
+
+	void load_row(std::uint32_t slot, std::vector<int>& row) const
+	{
+		auto src = cells.begin() + slot * width;
+		std::copy(src, src + width, row.begin());
+	}
+
+	// Drop the oldest or the newest state
+	void drop(std::size_t at)
+	{
+		auto const *ids = row_ids(at);
+		for(std::size_t y = 0; y < height; ++y)
+			if (--refs[ids[y]] == 0)
+				free_slots.push_back(ids[y]);
+
+		if (at == first)
+			first = (first + 1) % capacity;
+		--count;
+	}
+
+	static void save(state& s, engine const& e)
+	{
+		s.score = e.score;
+		s.drop_height = e.drop_height;
+		s.piece_state = e.piece_state;
+		s.game_over = e.game_over;
+		s.active = save_piece(e.active_piece.get());
+		s.next = save_piece(e.next_piece.get());
+	}
+
+	static void load(state const& s, engine& e)
+	{
+		e.score = s.score;
+		e.drop_height = s.drop_height;
+		e.piece_state = s.piece_state;
+		e.game_over = s.game_over;
+		e.recycle(std::move(e.active_piece));
+		e.recycle(std::move(e.next_piece));
+		e.active_piece = load_piece(s.active, &e);
+		e.next_piece = load_piece(s.next, &e);
+		++e.version;
+	}
+};
+
+}
+
+#endif // HISTORY_H
@@ -0,0 +1,118 @@
+#ifndef IDLE_TIMER_H
+#define IDLE_TIMER_H
+
+#include <algorithm>
+
+#include <final/final.h>
+
+// A widget's timer that runs at full rate while things happen and backs
+// off when they do not.  After idle_ms of ticks that changed nothing the
+// interval doubles, and again after every further idle_ms, up to
+// slow_ms; while the widget is hidden or in the background it runs at
+// background_ms, or not at all for 0.  busy(), e.g. on input, brings it
+// back to full rate at once.
+class idle_timer
+{
+public:
+	idle_timer(finalcut::FObject& o, int fast, int slow, int background = 0, int idle = 2000)
+		: owner(o)
+		, fast_ms(fast)
+		, slow_ms(std::max(fast, slow))
+		, background_ms(background)
+		, idle_ms(idle)
+	{}
+
+	idle_timer(idle_timer const&) = delete;
+	idle_timer& operator=(idle_timer const&) = delete;
+
+	void start()
+	{
+		quiet = 0;
+		rate = fast_ms;
+		apply();
+	}
+
+	void stop()
+	{
+		rate = 0;
+		apply();
+	}
+
+	// ev is this timer's
+	bool is(finalcut::FTimerEvent *ev) const
+	{
+		return id && ev->getTimerId() == id;
+	}
+
+	// After every tick: whether it changed anything visible
+	void tick(bool changed)
+	{
+		if (changed) {
+			busy();
+			return;
+		}
+
+		quiet += current;
+		if (quiet >= idle_ms && rate < slow_ms) {
+			quiet = 0;
+			rate = std::min(rate * 2, slow_ms);
+			apply();
+		}
+	}
+
+	void busy()
+	{
+		quiet = 0;
+		if (rate != fast_ms && rate != 0) {
+			rate = fast_ms;
+			apply();
+		}
+	}
+
+	// Hidden or behind other windows, or back
+	void background(bool b)
+	{
+		if (b == away)
+			return;
+		away = b;
+		quiet = 0;
+		if (!b && rate)
+			rate = fast_ms;
+		apply();
+	}
+
+	bool inBackground() const
+	{
+		return away;
+	}
+
+	// Milliseconds between ticks now, 0 while stopped
+	int interval() const
+	{
+		return current;
+	}
+
+private:
+	finalcut::FObject& owner;
+	int fast_ms, slow_ms, background_ms, idle_ms;
+
+	int id{0};
+	int current{0};     // what the finalcut timer runs at
+	int rate{0};        // what it would in the foreground
+	int quiet{0};
+	bool away{false};
+
+	void apply()
+	{
+		auto ms = away && rate ? background_ms : rate;
+		if (ms == current)
+			return;
+
+		if (id)
+			owner.delTimer(id);
+		id = ms > 0 ? owner.addTimer(ms) : 0;
+		current = ms;
+	}
+};
+
+#endif // IDLE_TIMER_H
@@ -1,12 +1,30 @@
 #include <iostream>
+#include <cstring>
+#include <memory>
+#include <string>
 
 #include <final/final.h>
 
+#include "asciicast.h"
+#include "idle_timer.h"
+#include "layout_pass.h"
+
 namespace fc = finalcut;
 
 class HelloDialog : public fc::FDialog
 {
 	fc::FLabel labelDim{this};
+	layout_pass layout{*this};
+
+	// size the label text was made for
+	std::size_t labelWidth = 0, labelHeight = 0;
+	fc::FString labelText;
+
+	// dots go after the text until it fills the label, then start over;
+	// they are all that changes, so the timer soon slows down to a
+	// second a dot, and stops while the dialog is hidden
+	idle_timer dots{*this, 100, 1000};
+	std::size_t dotCount = 0;
 
 public:
 	HelloDialog(fc::FWidget& widget)
@@ -26,32 +44,85 @@ public:
 
 		labelDim.setSize({30,1});
 
-		labelDim = "Size: ";
-		labelDim << labelDim.getWidth() << "x" << labelDim.getHeight();
+		relabel();
+		layout.then([this](std::size_t, std::size_t) { relabel(); });
+		layout.run();
 
-		addTimer(100);
+		dots.start();
 	}
 
 	void onTimer (fc::FTimerEvent *ev) override
 	{
-		labelDim.getText() << ".";
+		if (layout.timer(ev) || !dots.is(ev))
+			return;
+
+		if (labelText.getLength() + ++dotCount > labelWidth)
+			dotCount = 0;
+
+		fc::FString s{labelText};
+		s << fc::FString(dotCount, L'.');
+		labelDim = s;
 
 		// adjustSize();
 
-		redraw();
+		// only the label changed
+		labelDim.redraw();
+		dots.tick(false);
 	}
 
-	void adjustSize() override
+	void onKeyPress(fc::FKeyEvent *ev) override
 	{
-		labelDim = "Size: ";
-		labelDim << labelDim.getWidth() << "x" << labelDim.getHeight();
+		dots.busy();
+		fc::FDialog::onKeyPress(ev);
+	}
+
+	void onShow(fc::FShowEvent *ev) override
+	{
+		dots.background(false);
+		fc::FDialog::onShow(ev);
+	}
 
+	void onHide(fc::FHideEvent *ev) override
+	{
+		dots.background(true);
+		fc::FDialog::onHide(ev);
+	}
+
+	void adjustSize() override
+	{
 		fc::FDialog::adjustSize();
+
+		// relabel() once a frame, not for every resize event
+		layout.invalidate();
+	}
+
+	void relabel()
+	{
+		if (labelWidth == labelDim.getWidth() && labelHeight == labelDim.getHeight())
+			return;
+
+		labelWidth = labelDim.getWidth();
+		labelHeight = labelDim.getHeight();
+
+		labelText = "Size: ";
+		labelText << labelWidth << "x" << labelHeight;
+		labelDim = labelText;
+		dotCount = 0;
 	}
 };
 
+// labelsizebug [--record FILE]
+//
+// --record writes the session to FILE in asciicast format (see
+// asciicast.h).
 int main(int argc, char **argv)
 {
+	auto session = asciicast::from_args(argc, argv);
+	if (session && !session->ok()) {
+		std::cerr << "cannot record to " << session->path() << "\n";
+		return 2;
+	}
+
 	fc::FApplication app{argc, argv};
 	HelloDialog dialog{app};
 	app.setMainWidget(&dialog);
@@ -0,0 +1,147 @@
+#ifndef LAYOUT_PASS_H
+#define LAYOUT_PASS_H
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include <final/final.h>
+
+// Layout of a widget's children from its client size, done at most once
+// a frame however many resize events arrive in it.
+//
+// The widget's adjustSize() only calls invalidate(); the first call of a
+// burst starts a one-shot timer, and the widget's onTimer() hands its
+// events to timer(), which lays out once for the size the widget has by
+// then.  Each child's box is kept with the client size it was worked out
+// for: while that size is the same nothing is recomputed, and otherwise
+// only children whose box moved get setGeometry(), so their own
+// adjustSize() and repaint run when they have to.
+class layout_pass
+{
+public:
+	struct box
+	{
+		int x, y;
+		std::size_t width, height;
+
+		bool operator==(box const& o) const
+		{
+			return x == o.x && y == o.y && width == o.width && height == o.height;
+		}
+	};
+
+	// A child's box from the client width and height
+	using rule = std::function<box(std::size_t, std::size_t)>;
+
+	explicit layout_pass(finalcut::FWidget& w, int frame_ms = 16)
+		: owner(w)
+		, frame(frame_ms)
+	{}
+
+	layout_pass(layout_pass const&) = delete;
+	layout_pass& operator=(layout_pass const&) = delete;
+
+	void place(finalcut::FWidget& child, rule r)
+	{
+		children.push_back({&child, std::move(r), {}, false});
+		sized = false;
+	}
+
+	// f(width, height) runs in a pass after the children, when the client
+	// size changed, e.g. to reword a label about it
+	void then(std::function<void(std::size_t, std::size_t)> f)
+	{
+		after.push_back(std::move(f));
+		sized = false;
+	}
+
+	// From adjustSize()
+	void invalidate()
+	{
+		++requested;
+		if (!timer_id)
+			timer_id = owner.addTimer(frame);
+	}
+
+	// From onTimer(); true when ev was the layout's own timer
+	bool timer(finalcut::FTimerEvent *ev)
+	{
+		if (!timer_id || ev->getTimerId() != timer_id)
+			return false;
+
+		owner.delTimer(timer_id);
+		timer_id = 0;
+
+		if (run())
+			owner.redraw();
+		return true;
+	}
+
+	// Lay out now, e.g. once the constructor has placed everything;
+	// returns whether any child moved
+	bool run()
+	{
+		std::size_t w = owner.getClientWidth();
+		std::size_t h = owner.getClientHeight();
+
+		if (sized && w == width && h == height)
+			return false;
+		sized = true;
+		width = w;
+		height = h;
+		++passes_run;
+
+		bool moved = false;
+		for(auto& c : children) {
+			auto b = c.how(w, h);
+			if (c.placed && b == c.last)
+				continue;
+
+			c.last = b;
+			c.placed = true;
+			c.widget->setGeometry({b.x, b.y}, {b.width, b.height});
+			moved = true;
+		}
+
+		for(auto& f : after)
+			f(w, h);
+
+		return moved || !after.empty();
+	}
+
+	// adjustSize() calls seen, and the layouts they came to
+	std::size_t requests() const
+	{
+		return requested;
+	}
+
+	std::size_t passes() const
+	{
+		return passes_run;
+	}
+
+private:
+	struct child
+	{
+		finalcut::FWidget *widget;
+		rule how;
+		box last;
+		bool placed;
+	};
+
+	finalcut::FWidget& owner;
+	int frame;
+	int timer_id{0};
+
+	std::vector<child> children;
+	std::vector<std::function<void(std::size_t, std::size_t)>> after;
+
+	bool sized{false};
+	std::size_t width{0}, height{0};
+
+	std::size_t requested{0};
+	std::size_t passes_run{0};
+};
+
+#endif // LAYOUT_PASS_H
@@ -0,0 +1,249 @@
+#ifndef LINE_RING_H
+#define LINE_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <unistd.h>
+
+// Lines of text from a producer thread to a UI, in fixed memory: the
+// producer fills a bounded lock-free queue, the UI moves what is queued
+// into a history of the last lines on its own timer and shows some of
+// them.  Lines are cut at line::max_bytes.
+namespace logtail {
+
+struct line
+{
+	static constexpr std::size_t max_bytes = 254;
+
+	std::uint16_t size{0};
+	char text[max_bytes];
+
+	void assign(char const *s, std::size_t n)
+	{
+		size = std::min(n, max_bytes);
+		std::memcpy(text, s, size);
+	}
+};
+
+// Queue of lines from one producer thread to one consumer
+class line_queue
+{
+public:
+	explicit line_queue(std::size_t capacity_log2 = 14)
+		: slots(std::size_t(1) << capacity_log2)
+	{}
+
+	std::size_t capacity() const
+	{
+		return slots.size();
+	}
+
+	// false, and nothing queued, when it is full
+	bool push(char const *s, std::size_t n)
+	{
+		auto h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == slots.size())
+			return false;
+
+		slots[h & (slots.size() - 1)].assign(s, n);
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Hand every queued line to f(line const&), oldest first; returns
+	// their number
+	template <typename F>
+	std::size_t drain(F&& f)
+	{
+		auto t = tail.load(std::memory_order_relaxed);
+		auto h = head.load(std::memory_order_acquire);
+
+		for(auto i = t; i < h; ++i)
+			f(slots[i & (slots.size() - 1)]);
+
+		tail.store(h, std::memory_order_release);
+		return h - t;
+	}
+
+private:
+	std::vector<line> slots;
+
+	alignas(64) std::atomic<std::uint64_t> head{0};
+	alignas(64) std::atomic<std::uint64_t> tail{0};
+};
+
+// The last lines added, the oldest overwritten, for one thread
+class line_history
+{
+public:
+	explicit line_history(std::size_t capacity)
+		: slots(std::max<std::size_t>(capacity, 1))
+	{}
+
+	std::size_t capacity() const
+	{
+		return slots.size();
+	}
+
+	void add(line const& l)
+	{
+		slots[added++ % slots.size()] = l;
+	}
+
+	// Lines added so far; line n of them is kept while n is one of the
+	// last capacity()
+	std::uint64_t count() const
+	{
+		return added;
+	}
+
+	line const *at(std::uint64_t n) const
+	{
+		if (n >= added || added - n > slots.size())
+			return nullptr;
+		return &slots[n % slots.size()];
+	}
+
+private:
+	std::vector<line> slots;
+	std::uint64_t added{0};
+};
+
+// Producer thread: lines read from a file descriptor until its end, or
+// a made-up ticker at a given rate.  A full queue makes it wait, so a
+// pipe it reads from backs up instead of losing lines.
+class line_source
+{
+public:
+	// Reads fd, which it then owns
+	line_source(line_queue& q, int fd)
+		: queue(q)
+	{
+		thread = std::thread([this, fd] { read_lines(fd); });
+	}
+
+	// per_second lines of ticker
+	line_source(line_queue& q, double per_second)
+		: queue(q)
+	{
+		thread = std::thread([this, per_second] { tick_lines(per_second); });
+	}
+
+	line_source(line_source const&) = delete;
+	line_source& operator=(line_source const&) = delete;
+
+	~line_source()
+	{
+		stopping.store(true, std::memory_order_relaxed);
+		thread.join();
+	}
+
+	std::uint64_t produced() const
+	{
+		return lines.load(std::memory_order_relaxed);
+	}
+
+	bool finished() const
+	{
+		return done.load(std::memory_order_acquire);
+	}
+
+private:
+	line_queue& queue;
+	std::thread thread;
+	std::atomic<bool> stopping{false};
+	std::atomic<bool> done{false};
+	std::atomic<std::uint64_t> lines{0};
+
+	bool stop() const
+	{
+		return stopping.load(std::memory_order_relaxed);
+	}
+
+	void push(char const *s, std::size_t n)
+	{
+		while(!queue.push(s, n)) {
+			if (stop())
+				return;
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+		lines.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void read_lines(int fd)
+	{
+		std::vector<char> buf(1 << 16);
+		std::size_t have = 0;
+
+		while(!stop()) {
+			// wake up now and then to notice stop()
+			pollfd p{fd, POLLIN, 0};
+			if (poll(&p, 1, 100) <= 0)
+				continue;
+
+			auto n = ::read(fd, buf.data() + have, buf.size() - have);
+			if (n <= 0)
+				break;
+			have += n;
+
+			std::size_t from = 0;
+			for(std::size_t i = 0; i < have; ++i)
+				if (buf[i] == '\n') {
+					push(buf.data() + from, i - from);
+					from = i + 1;
+				}
+
+			// a line longer than the buffer goes out in pieces
+			if (from == 0 && have == buf.size()) {
+				push(buf.data(), have);
+				from = have;
+			}
+
+			std::memmove(buf.data(), buf.data() + from, have - from);
+			have -= from;
+		}
+
+		if (have)
+			push(buf.data(), have);
+
+		::close(fd);
+		done.store(true, std::memory_order_release);
+	}
+
+	void tick_lines(double per_second)
+	{
+		using clock = std::chrono::steady_clock;
+		auto start = clock::now();
+		std::uint64_t n = 0;
+		char text[64];
+
+		while(!stop()) {
+			// catch up with the rate, then sleep a little
+			std::chrono::duration<double> t = clock::now() - start;
+			auto due = std::uint64_t(t.count() * per_second);
+
+			for(; n < due && !stop(); ++n) {
+				auto len = std::snprintf(text, sizeof(text), "%8.3f  tick %llu",
+				                         t.count(), (unsigned long long)n);
+				push(text, len);
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		done.store(true, std::memory_order_release);
+	}
+};
+
+}
+
+#endif // LINE_RING_H
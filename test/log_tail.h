@@ -0,0 +1,114 @@
+#ifndef LOG_TAIL_H
+#define LOG_TAIL_H
+
+#include <string>
+
+#include <final/final.h>
+
+#include "line_ring.h"
+#include "partial_redraw.h"
+
+// Scrolling view of the last lines of a log (see line_ring.h).  A
+// producer pushes into queue() from its own thread; poll(), from a
+// timer, takes what arrived and repaints only the rows whose line
+// changed, so the cost of a frame is the visible rows whatever the rate
+// lines come in at.  Memory is the queue plus history_lines lines.
+//
+// scroll() moves the view back from the tail; while it is away from the
+// tail, new lines do not move the view.
+class LogTail : public finalcut::FWidget
+{
+public:
+	explicit LogTail(finalcut::FWidget *parent, std::size_t history_lines = 4096)
+		: finalcut::FWidget(parent)
+		, history(history_lines)
+	{}
+
+	logtail::line_queue& queue()
+	{
+		return incoming;
+	}
+
+	// Lines arrived so far
+	std::uint64_t count() const
+	{
+		return history.count();
+	}
+
+	// Take the queued lines and repaint what they changed; returns how
+	// many there were
+	std::size_t poll()
+	{
+		auto n = incoming.drain([this](logtail::line const& l) { history.add(l); });
+
+		if (offset > 0)
+			offset = std::min<std::uint64_t>(offset + n, maxOffset());
+
+		if (n)
+			drawn.repaint();
+
+		return n;
+	}
+
+	// Rows back from the tail, 0 follows it
+	void scroll(long rows)
+	{
+		auto o = std::max<long>(long(offset) + rows, 0);
+		offset = std::min<std::uint64_t>(o, maxOffset());
+		drawn.repaint();
+	}
+
+	bool following() const
+	{
+		return offset == 0;
+	}
+
+	void draw() override
+	{
+		std::size_t rows = getHeight();
+		std::size_t cols = getWidth();
+
+		if (drawn.begin(rows, cols))
+			blank = finalcut::FString(cols, L' ');
+
+		setColor();
+
+		auto end = history.count() - std::min<std::uint64_t>(offset, history.count());
+
+		for(std::size_t r = 0; r < rows; ++r) {
+			// the line of row r, counting back from the bottom row
+			auto back = rows - r;
+			logtail::line const *l = nullptr;
+			auto key = partial_redraw::empty;
+			if (end >= back && (l = history.at(end - back)))
+				key = end - back;
+
+			if (!drawn.update(r, key))
+				continue;
+
+			print() << finalcut::FPoint(1, int(r) + 1) << blank;
+			if (l) {
+				finalcut::FString text{std::string(l->text, l->size)};
+				print() << finalcut::FPoint(1, int(r) + 1)
+				        << (text.getLength() > cols ? text.left(cols) : text);
+			}
+		}
+	}
+
+private:
+	logtail::line_queue incoming;
+	logtail::line_history history;
+	std::uint64_t offset{0};
+
+	// the line in each row, keyed by its number
+	partial_redraw drawn{*this};
+	finalcut::FString blank;
+
+	std::uint64_t maxOffset() const
+	{
+		auto kept = std::min<std::uint64_t>(history.count(), history.capacity());
+		return kept > getHeight() ? kept - getHeight() : 0;
+	}
+};
+
+#endif // LOG_TAIL_H
@@ -0,0 +1,76 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A whole file mapped read-only, unmapped again with the object.  An
+// empty or missing file gives an empty mapping.
+class mapped_file
+{
+public:
+	mapped_file() = default;
+
+	explicit mapped_file(std::string const& path)
+	{
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return;
+
+		struct stat st;
+		if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+			void *p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED) {
+				ptr = static_cast<const char *>(p);
+				bytes = st.st_size;
+			}
+		}
+
+		::close(fd);
+	}
+
+	~mapped_file()
+	{
+		if (ptr)
+			::munmap(const_cast<char *>(ptr), bytes);
+	}
+
+	mapped_file(mapped_file&& o) noexcept
+		: ptr(o.ptr)
+		, bytes(o.bytes)
+	{
+		o.ptr = nullptr;
+		o.bytes = 0;
+	}
+
+	mapped_file& operator=(mapped_file&& o) noexcept
+	{
+		std::swap(ptr, o.ptr);
+		std::swap(bytes, o.bytes);
+		return *this;
+	}
+
+	mapped_file(mapped_file const&) = delete;
+	mapped_file& operator=(mapped_file const&) = delete;
+
+	const char *data() const
+	{
+		return ptr;
+	}
+
+	std::size_t size() const
+	{
+		return bytes;
+	}
+
+private:
+	const char *ptr{nullptr};
+	std::size_t bytes{0};
+};
+
+#endif // MAPPED_FILE_H
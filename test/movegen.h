@@ -0,0 +1,384 @@
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include <array>
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+
+#include "board_features.h"
+#include "placement.h"
+#include "tetris_engine.h"
+
+namespace game {
+
+// One input to the engine: move_left(), move_right(), rotate(), or an
+// update() that lets the piece fall a row without locking it.
+enum class move : std::uint8_t
+{
+	left,
+	right,
+	rotate,
+	down
+};
+
+// Feed one input to the engine; returns the lines a down cleared
+inline cleared_rows apply(engine& eng, move m)
+{
+	switch(m) {
+	case move::left:
+		eng.move_left();
+		break;
+
+	case move::right:
+		eng.move_right();
+		break;
+
+	case move::rotate:
+		eng.rotate();
+		break;
+
+	case move::down:
+		return eng.update();
+	}
+
+	return {};
+}
+
+// The engine action of an input; a down is a tick without one
+inline action to_action(move m)
+{
+	switch(m) {
+	case move::left:
+		return action::left;
+
+	case move::right:
+		return action::right;
+
+	case move::rotate:
+		return action::rotate;
+
+	case move::down:
+		break;
+	}
+
+	return action::none;
+}
+
+// A place the active piece can come to rest: origin, and the number of
+// rotate() calls from the orientation it has now.
+struct landing
+{
+	int x, y, rotation;
+	std::uint16_t node;
+};
+
+// Breadth-first search over every (x, y, rotation) the active piece can
+// reach, with the engine's own collision and wall kick rules, so tucks
+// under overhangs and spins into holes are found as well.
+//
+// Any number of inputs is allowed between two gravity ticks, as in the
+// game window.  All search state lives in fixed arrays of the generator,
+// so one generator is reused for many searches without allocating, and
+// collisions are tested against the row masks of placement.h.
+// Positions that cover the same cells are reported once, with the
+// shortest path.
+class move_generator
+{
+public:
+	static constexpr std::size_t max_states =
+		bitboard::max_width * bitboard::max_height * 4;
+
+	// Search from the engine's active piece; returns the number of
+	// landings, none without an active piece.
+	std::size_t generate(engine const& eng)
+	{
+		if (!eng.active_piece) {
+			count = 0;
+			return 0;
+		}
+
+		return generate(to_bitboard(eng, false), *eng.active_piece,
+		                eng.active_piece->orig_x, eng.active_piece->orig_y);
+	}
+
+	// Search for piece p with its origin at (x, y) on board b, as after
+	// a spawn; none if it does not fit there or b is larger than a
+	// bitboard can be.
+	std::size_t generate(bitboard const& b, piece const& p, int x, int y)
+	{
+		count = 0;
+		if (!bitboard::fits(b.width, b.height))
+			return 0;
+		visited.reset();
+		landed.reset();
+
+		bits = b;
+		width = bits.width;
+		height = bits.height;
+		shapes(p);
+
+		masks = &placement_masks_for(width);
+		kind = engine::kind_of(p.id);
+		base = rotation_of(p);
+
+		if (collides(x, y, 0))
+			return 0;
+
+		std::size_t tail = 0;
+		auto push = [&](int nx, int ny, int r, std::uint16_t parent, move via) {
+			auto i = index(nx, ny, r);
+			if (visited[i])
+				return;
+
+			visited[i] = true;
+			nodes[tail++] = {std::int8_t(nx), std::int8_t(ny), std::int8_t(r),
+			                 via, parent};
+		};
+
+		push(x, y, 0, 0xffff, move::down);
+
+		for(std::size_t head = 0; head < tail; ++head) {
+			x = nodes[head].x;
+			y = nodes[head].y;
+			int r = nodes[head].r;
+			auto self = std::uint16_t(head);
+
+			if (!collides(x - 1, y, r))
+				push(x - 1, y, r, self, move::left);
+
+			if (!collides(x + 1, y, r))
+				push(x + 1, y, r, self, move::right);
+
+			// same kick order as engine::rotate()
+			int nr = (r + 1) & 3;
+			for(int kick : {0, -1, -2, +1, +2})
+				if (!collides(x + kick, y, nr)) {
+					push(x + kick, y, nr, self, move::rotate);
+					break;
+				}
+
+			if (!collides(x, y + 1, r))
+				push(x, y + 1, r, self, move::down);
+			else
+				land(x, y, r, self);
+		}
+
+		return count;
+	}
+
+	std::size_t size() const
+	{
+		return count;
+	}
+
+	landing const *begin() const
+	{
+		return found.data();
+	}
+
+	landing const *end() const
+	{
+		return found.data() + count;
+	}
+
+	landing const& operator[](std::size_t i) const
+	{
+		return found[i];
+	}
+
+	// The searched board, without the active piece
+	bitboard const& board() const
+	{
+		return bits;
+	}
+
+	// Add the cells of a landed piece to b
+	void place(landing const& l, bitboard& b) const
+	{
+		if (base >= 0) {
+			placement_table::place(b, (*masks)(kind, base + l.rotation, l.x), l.y);
+			return;
+		}
+
+		for(auto c : cur->cells[l.rotation])
+			b.rows[l.y + c.second] |= 1u << (l.x + c.first);
+	}
+
+	// Writes the inputs leading to l into out and returns their number;
+	// nothing is written when there are more than max.
+	std::size_t path(landing const& l, move *out, std::size_t max) const
+	{
+		std::size_t n = 0;
+		for(auto i = l.node; nodes[i].parent != 0xffff; i = nodes[i].parent)
+			++n;
+
+		if (n > max)
+			return n;
+
+		std::size_t k = n;
+		for(auto i = l.node; nodes[i].parent != 0xffff; i = nodes[i].parent)
+			out[--k] = nodes[i].via;
+
+		return n;
+	}
+
+	// Feed the path to l into the engine the search ran on.  The piece
+	// is left resting at l; the next update() locks it.
+	void play(engine& eng, landing const& l) const
+	{
+		play(eng, l, [](move) {});
+	}
+
+	// Same, also handing every input to observe, e.g. for recording
+	template <typename F>
+	void play(engine& eng, landing const& l, F&& observe) const
+	{
+		std::array<move, max_states> moves;
+		auto n = path(l, moves.data(), moves.size());
+
+		for(std::size_t i = 0; i < n; ++i) {
+			observe(moves[i]);
+			apply(eng, moves[i]);
+		}
+	}
+
+private:
+	struct node
+	{
+		std::int8_t x, y, r;
+		move via;
+		std::uint16_t parent;
+	};
+
+	std::array<node, max_states> nodes;
+	std::array<landing, max_states> found;
+	std::bitset<max_states> visited, landed;
+	std::size_t count{0};
+
+	bitboard bits;
+	int width{0}, height{0};
+
+	// masks of the searched piece, by rotation from its spawn; base is
+	// the rotation it has now, -1 for a piece the engine did not make,
+	// which is tested cell by cell
+	placement_table const *masks{nullptr};
+	std::size_t kind{0};
+	int base{-1};
+
+	struct shape
+	{
+		int id{0};
+
+		// origin first, then the three blocks, per rotation
+		std::pair<int, int> cells[4][4];
+
+		// rotations that cover the same cells as an earlier one, shifted
+		int same_as[4];
+		std::pair<int, int> shift[4];
+	};
+
+	// the rotations of the pieces seen last, so repeated searches do
+	// not need to clone the piece again
+	std::array<shape, 8> shape_cache;
+	std::size_t shape_next{0};
+	shape const *cur{nullptr};
+
+	static std::size_t index(int x, int y, int r)
+	{
+		return (y * bitboard::max_width + x) * 4 + r;
+	}
+
+	void shapes(piece const& p)
+	{
+		for(auto& sh : shape_cache)
+			if (sh.id == p.id
+			    && std::equal(p.blocks.begin(), p.blocks.end(), sh.cells[0] + 1)) {
+				cur = &sh;
+				return;
+			}
+
+		auto& sh = shape_cache[shape_next++ % shape_cache.size()];
+		cur = &sh;
+
+		auto rot = p.clone();
+		sh.id = p.id;
+
+		for(int r = 0; r < 4; ++r) {
+			sh.cells[r][0] = {0, 0};
+			for(int b = 0; b < 3; ++b)
+				sh.cells[r][b + 1] = rot->blocks[b];
+			rot->rotate();
+
+			sh.same_as[r] = r;
+			sh.shift[r] = {0, 0};
+
+			for(int q = 0; q < r; ++q)
+				if (congruent(q, r)) {
+					sh.same_as[r] = sh.same_as[q];
+					sh.shift[r] = {sh.shift[q].first + corner(r).first - corner(q).first,
+					               sh.shift[q].second + corner(r).second - corner(q).second};
+					break;
+				}
+		}
+	}
+
+	std::pair<int, int> corner(int r) const
+	{
+		auto c = cur->cells[r][0];
+		for(auto b : cur->cells[r])
+			c = {std::min(c.first, b.first), std::min(c.second, b.second)};
+		return c;
+	}
+
+	// same cells up to a translation
+	bool congruent(int q, int r) const
+	{
+		auto cq = corner(q), cr = corner(r);
+
+		for(auto a : cur->cells[r]) {
+			bool match = false;
+			for(auto b : cur->cells[q])
+				match = match || (a.first - cr.first == b.first - cq.first
+				                  && a.second - cr.second == b.second - cq.second);
+			if (!match)
+				return false;
+		}
+
+		return true;
+	}
+
+	// engine::check_collision() on the board without the active piece
+	bool collides(int x, int y, int r) const
+	{
+		if (base >= 0)
+			return masks->collides(bits, (*masks)(kind, base + r, x), y);
+
+		for(int i = 0; i < 4; ++i) {
+			int cx = x + cur->cells[r][i].first;
+			int cy = y + cur->cells[r][i].second;
+
+			if ((i > 0 && cy <= 0) || cy < 0 || cy >= height
+			    || cx < 0 || cx >= width
+			    || (bits.rows[cy] >> cx) & 1u)
+				return true;
+		}
+
+		return false;
+	}
+
+	void land(int x, int y, int r, std::uint16_t n)
+	{
+		auto key = index(x + cur->shift[r].first, y + cur->shift[r].second,
+		                 cur->same_as[r]);
+		if (landed[key])
+			return;
+
+		landed[key] = true;
+		found[count++] = {x, y, r, n};
+	}
+};
+
+}
+
+#endif // MOVEGEN_H
@@ -0,0 +1,66 @@
+#ifndef PARTIAL_REDRAW_H
+#define PARTIAL_REDRAW_H
+
+#include <cstdint>
+#include <vector>
+
+#include <final/final.h>
+
+// What each row of a widget showed at its last draw(), so the widget's
+// own repaint() redraws only the rows whose content changed.  A row's
+// content is a key of the widget's choosing, e.g. the number of the line
+// in it.  Any other redraw may have painted over everything, e.g. when
+// the widget was uncovered, and so does a new size: then every row is
+// drawn again.
+class partial_redraw
+{
+public:
+	// a row drawn blank, as a key
+	static constexpr std::uint64_t empty = ~0ull - 1;
+
+	explicit partial_redraw(finalcut::FWidget& w)
+		: widget(w)
+	{}
+
+	partial_redraw(partial_redraw const&) = delete;
+	partial_redraw& operator=(partial_redraw const&) = delete;
+
+	// Redraw the widget, keeping the rows that still show the same
+	void repaint()
+	{
+		own = true;
+		widget.redraw();
+	}
+
+	// At the start of draw(): true if every row has to be drawn
+	bool begin(std::size_t rows, std::size_t cols)
+	{
+		bool full = !own || shown.size() != rows || cols != width;
+		own = false;
+		width = cols;
+
+		if (full)
+			shown.assign(rows, none);
+		return full;
+	}
+
+	// Row r is to show key: false if it already does, else true and it
+	// is taken as drawn
+	bool update(std::size_t r, std::uint64_t key)
+	{
+		if (shown[r] == key)
+			return false;
+		shown[r] = key;
+		return true;
+	}
+
+private:
+	static constexpr std::uint64_t none = ~0ull;
+
+	finalcut::FWidget& widget;
+	std::vector<std::uint64_t> shown;
+	std::size_t width{0};
+	bool own{false};
+};
+
+#endif // PARTIAL_REDRAW_H
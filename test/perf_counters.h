@@ -0,0 +1,191 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <utility>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware performance counters read through perf_event_open(2).
+//
+// A perf::group opens cycles, instructions, L1 data cache read misses,
+// last level cache misses and branch misses as one counter group for
+// the calling thread, user space only.  Counters the machine or the
+// kernel does not offer are left out; if none can be opened ok() is
+// false and every sample reads zero, so callers can always measure and
+// only decide at output time whether there is anything to show.
+namespace perf {
+
+enum counter
+{
+	cycles,
+	instructions,
+	l1d_misses,
+	llc_misses,
+	branch_misses,
+	counter_count
+};
+
+inline const char* counter_name(int c)
+{
+	static const char *names[counter_count] = {
+		"cycles",
+		"instructions",
+		"l1d_misses",
+		"llc_misses",
+		"branch_misses"
+	};
+
+	return names[c];
+}
+
+struct sample
+{
+	std::uint64_t v[counter_count]{};
+
+	sample& operator+=(sample const& rhs)
+	{
+		for(int i = 0; i < counter_count; ++i)
+			v[i] += rhs.v[i];
+		return *this;
+	}
+
+	sample operator-(sample const& rhs) const
+	{
+		sample d;
+		for(int i = 0; i < counter_count; ++i)
+			d.v[i] = v[i] - rhs.v[i];
+		return d;
+	}
+};
+
+class group
+{
+	int leader{-1};
+	int fds[counter_count];
+	int order[counter_count];  // counter behind each value read back
+	int opened{0};
+
+public:
+	group()
+	{
+		std::fill(fds, fds + counter_count, -1);
+
+#ifdef __linux__
+		auto cache = [](std::uint64_t id, std::uint64_t op, std::uint64_t result) {
+			return id | (op << 8) | (result << 16);
+		};
+
+		const std::pair<std::uint32_t, std::uint64_t> events[counter_count] = {
+			{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+			{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+			{PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_L1D,
+			                           PERF_COUNT_HW_CACHE_OP_READ,
+			                           PERF_COUNT_HW_CACHE_RESULT_MISS)},
+			{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+			{PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+		};
+
+		for(int c = 0; c < counter_count; ++c) {
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = events[c].first;
+			attr.config = events[c].second;
+			attr.read_format = PERF_FORMAT_GROUP;
+			attr.disabled = leader == -1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+
+			int fd = syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+			if (fd == -1)
+				continue;
+
+			if (leader == -1)
+				leader = fd;
+
+			fds[c] = fd;
+			order[opened++] = c;
+		}
+
+		if (leader != -1) {
+			ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+			ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		}
+#endif
+	}
+
+	~group()
+	{
+#ifdef __linux__
+		for(auto fd : fds)
+			if (fd != -1)
+				close(fd);
+#endif
+	}
+
+	group(group const&) = delete;
+	group& operator=(group const&) = delete;
+
+	bool ok() const
+	{
+		return leader != -1;
+	}
+
+	bool has(counter c) const
+	{
+		return fds[c] != -1;
+	}
+
+	// Current totals; subtract two reads to get the counts in between.
+	sample read() const
+	{
+		sample s;
+
+#ifdef __linux__
+		if (leader == -1)
+			return s;
+
+		std::uint64_t buf[1 + counter_count];
+		if (::read(leader, buf, sizeof(buf)) < (ssize_t)sizeof(std::uint64_t))
+			return s;
+
+		for(std::uint64_t i = 0; i < buf[0] && i < (std::uint64_t)opened; ++i)
+			s.v[order[i]] = buf[1 + i];
+#endif
+
+		return s;
+	}
+
+	// Counters as a JSON object, or null when nothing could be opened.
+	void write_json(std::ostream& os, sample const& s) const
+	{
+		if (!ok()) {
+			os << "null";
+			return;
+		}
+
+		os << "{";
+		const char *sep = "";
+		for(int c = 0; c < counter_count; ++c) {
+			if (!has(counter(c)))
+				continue;
+
+			os << sep << "\"" << counter_name(c) << "\": " << s.v[c];
+			sep = ", ";
+		}
+		os << "}";
+	}
+};
+
+}
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,277 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace game {
+
+// A bitboard keeps one 32 bit mask per row, bit x set when column x is
+// filled, row 0 at the top.
+struct bitboard
+{
+	static constexpr std::size_t max_width = 30;
+	static constexpr std::size_t max_height = 32;
+
+	std::uint8_t width{0}, height{0};
+	std::uint32_t rows[max_height]{};
+
+	static constexpr bool fits(std::size_t w, std::size_t h)
+	{
+		return w <= max_width && h <= max_height;
+	}
+};
+
+// Cells of every piece kind (engine::make_piece()) after r rotate()
+// calls from how it spawns: the origin, then the three blocks in the
+// engine's order.  The same rules as the piece classes, worked out at
+// compile time.
+struct piece_cells
+{
+	std::int8_t x[4]{}, y[4]{};
+};
+
+namespace detail {
+
+constexpr piece_cells cells(int const (&b)[3][2])
+{
+	piece_cells c;
+	for(int i = 0; i < 3; ++i) {
+		c.x[i + 1] = b[i][0];
+		c.y[i + 1] = b[i][1];
+	}
+	return c;
+}
+
+// t, s and z turn (x, y) into (-y, x), i swaps them, o stays
+constexpr piece_cells turned(piece_cells c, std::size_t kind)
+{
+	for(int i = 1; i < 4; ++i) {
+		int x = c.x[i], y = c.y[i];
+		if (kind <= 2) {
+			c.x[i] = -y;
+			c.y[i] = x;
+		} else if (kind == 6) {
+			c.x[i] = y;
+			c.y[i] = x;
+		}
+	}
+	return c;
+}
+
+// The three blocks of a piece packed into 24 bits, 4 per coordinate,
+// for finding its rotation with a few compares
+constexpr std::uint32_t block_key(std::uint32_t key, int x, int y)
+{
+	return key << 8 | std::uint32_t(x & 15) << 4 | std::uint32_t(y & 15);
+}
+
+struct shape_set
+{
+	piece_cells at[7][4];
+	std::uint32_t key[7][4]{};
+};
+
+constexpr shape_set make_shapes()
+{
+	constexpr int spawn[7][3][2] = {
+		{{-1, 0}, { 0, -1}, { 1, 0}},   // t
+		{{ 0, -1}, { 1, -1}, {-1, 0}},  // s
+		{{-1, -1}, { 0, -1}, { 1, 0}},  // z
+		{{ 0, -1}, {-1, 0}, {-1, -1}},  // o
+		{},                             // l, from its table below
+		{},                             // j
+		{{ 1, 0}, { 2, 0}, { 3, 0}},    // i
+	};
+
+	// l_piece::rots and j_piece::rots
+	constexpr int lj[2][4][3][2] = {
+		{{{0, 1}, {1, 0}, {2, 0}}, {{0, 1}, {1, 1}, {0, -1}},
+		 {{0, -1}, {-1, 0}, {-2, 0}}, {{0, 1}, {0, -1}, {-1, -1}}},
+		{{{0, 1}, {-1, 0}, {-2, 0}}, {{1, 0}, {0, 1}, {0, 2}},
+		 {{0, 1}, {1, 1}, {2, 1}}, {{0, -1}, {0, 1}, {-1, 1}}},
+	};
+
+	shape_set s;
+	for(std::size_t k = 0; k < 7; ++k) {
+		if (k == 4 || k == 5) {
+			for(int r = 0; r < 4; ++r)
+				s.at[k][r] = cells(lj[k - 4][r]);
+			continue;
+		}
+
+		s.at[k][0] = cells(spawn[k]);
+		for(int r = 1; r < 4; ++r)
+			s.at[k][r] = turned(s.at[k][r - 1], k);
+	}
+
+	for(std::size_t k = 0; k < 7; ++k)
+		for(int r = 0; r < 4; ++r) {
+			s.key[k][r] = 0;
+			for(int i = 1; i < 4; ++i)
+				s.key[k][r] = block_key(s.key[k][r], s.at[k][r].x[i], s.at[k][r].y[i]);
+		}
+
+	return s;
+}
+
+}
+
+inline constexpr detail::shape_set piece_shapes = detail::make_shapes();
+
+// Where the cells of one piece in one rotation fall with its origin in
+// column x: rows y + top up to y + top + rows - 1 take mask[0..rows).
+// An origin row y is on the board from min_y, which keeps blocks out
+// of row 0 like engine::check_collision(), to height - 1 - bottom.
+struct placement
+{
+	bool fits{false};
+	std::int8_t top{0};
+	std::uint8_t rows{0};
+	std::int8_t min_y{0};
+	std::int8_t bottom{0};
+	std::uint32_t mask[4]{};
+};
+
+// Every placement on a board of one width, indexed by piece kind,
+// rotation and origin column.
+struct placement_table
+{
+	std::size_t width{0};
+	placement at[7][4][bitboard::max_width]{};
+
+	constexpr placement const& operator()(std::size_t kind, int r, int x) const
+	{
+		if (x < 0 || x >= int(width))
+			return none;
+		return at[kind][r & 3][x];
+	}
+
+	// engine::check_collision() on b, which holds the board without the
+	// active piece
+	constexpr bool collides(bitboard const& b, placement const& p, int y) const
+	{
+		if (!p.fits || y < p.min_y || y + p.bottom >= b.height)
+			return true;
+
+		std::uint32_t hit = 0;
+		for(int i = 0; i < p.rows; ++i)
+			hit |= b.rows[y + p.top + i] & p.mask[i];
+		return hit != 0;
+	}
+
+	// Row the piece lands on when dropped from row y, y itself if it
+	// cannot fall, or -1 if it collides there already
+	constexpr int drop(bitboard const& b, placement const& p, int y) const
+	{
+		if (collides(b, p, y))
+			return -1;
+		while(!collides(b, p, y + 1))
+			++y;
+		return y;
+	}
+
+	// Add the cells of the piece with its origin at (x, y) to b
+	static constexpr void place(bitboard& b, placement const& p, int y)
+	{
+		for(int i = 0; i < p.rows; ++i)
+			b.rows[y + p.top + i] |= p.mask[i];
+	}
+
+private:
+	static constexpr placement none{};
+};
+
+// Boards wider than a bitboard get an empty table, which fits nothing
+constexpr placement_table make_placement_table(std::size_t width)
+{
+	placement_table t;
+	if (width > bitboard::max_width)
+		return t;
+	t.width = width;
+
+	for(std::size_t k = 0; k < 7; ++k)
+		for(int r = 0; r < 4; ++r) {
+			auto const& c = piece_shapes.at[k][r];
+
+			int top = 0, bottom = 0, block_top = c.y[1];
+			for(int i = 0; i < 4; ++i) {
+				top = c.y[i] < top ? c.y[i] : top;
+				bottom = c.y[i] > bottom ? c.y[i] : bottom;
+				if (i > 0)
+					block_top = c.y[i] < block_top ? c.y[i] : block_top;
+			}
+
+			for(std::size_t x = 0; x < width; ++x) {
+				auto& p = t.at[k][r][x];
+				p.top = top;
+				p.rows = bottom - top + 1;
+				p.bottom = bottom;
+				p.min_y = -top > 1 - block_top ? -top : 1 - block_top;
+				p.fits = true;
+
+				for(int i = 0; i < 4; ++i) {
+					int cx = int(x) + c.x[i];
+					if (cx < 0 || cx >= int(width))
+						p.fits = false;
+					else
+						p.mask[c.y[i] - top] |= 1u << cx;
+				}
+			}
+		}
+
+	return t;
+}
+
+// Compiled in for board widths known ahead, e.g. a generator templated
+// on its width
+template <std::size_t Width>
+inline constexpr placement_table placement_masks = make_placement_table(Width);
+
+static_assert(!placement_masks<10>(0, 0, 0).fits, "a t piece needs the column left of it");
+static_assert(placement_masks<10>(6, 0, 6).mask[0] == 0x3c0u, "i piece lies flat");
+static_assert(placement_masks<10>(6, 1, 9).rows == 4, "i piece stands up");
+
+// The table for a width, all widths a bitboard holds built on first use;
+// wider boards get the one of width 0, which fits nothing
+inline placement_table const& placement_masks_for(std::size_t width)
+{
+	static std::array<placement_table, bitboard::max_width + 1> tables;
+	static bool const built = [] {
+		for(std::size_t w = 0; w < tables.size(); ++w)
+			tables[w] = make_placement_table(w);
+		return true;
+	}();
+	(void)built;
+
+	return width < tables.size() ? tables[width] : tables[0];
+}
+
+// Rotation of a piece of the given kind with these blocks (piece::blocks)
+// as in piece_shapes, or -1 for blocks no rotation of it has
+template <typename Blocks>
+inline int rotation_of(std::size_t kind, Blocks const& blocks)
+{
+	if (kind >= 7 || blocks.size() != 3)
+		return -1;
+
+	// any coordinate outside -8..7 sets a bit above the low 4
+	std::uint32_t key = 0, range = 0;
+	for(int i = 0; i < 3; ++i) {
+		int x = blocks[i].first, y = blocks[i].second;
+		range |= std::uint32_t(x + 8) | std::uint32_t(y + 8);
+		key = detail::block_key(key, x, y);
+	}
+
+	if (range > 15)
+		return -1;
+
+	auto const& keys = piece_shapes.key[kind];
+	return keys[0] == key ? 0 : keys[1] == key ? 1
+	     : keys[2] == key ? 2 : keys[3] == key ? 3 : -1;
+}
+
+}
+
+#endif // PLACEMENT_H
@@ -0,0 +1,225 @@
+#ifndef PROC_STATS_H
+#define PROC_STATS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// Resource use of one process from /proc, cheap enough to take every
+// second for hours.  The files are opened once and read again from the
+// start with pread() into fixed buffers, so a sample is four reads and
+// some parsing, with no opens and no allocations.
+namespace procstats {
+
+using clock = std::chrono::steady_clock;
+
+struct sample
+{
+	clock::time_point time;
+	bool alive{false};
+
+	std::uint64_t cpu_ticks{0};          // utime + stime
+	std::uint64_t rss_bytes{0};
+	std::uint64_t switches{0};           // voluntary and not
+	bool has_io{false};                  // /proc/PID/io needs ptrace rights
+	std::uint64_t io_bytes{0};           // read_bytes + write_bytes
+};
+
+// Per second between two samples
+struct rates
+{
+	double cpu_percent{0};               // of one core
+	double rss_bytes{0};
+	double switches{0};
+	double io_bytes{0};
+	bool has_io{false};
+};
+
+class sampler
+{
+public:
+	// pid 0 is this process
+	explicit sampler(pid_t pid = 0)
+	{
+		std::string dir = pid ? "/proc/" + std::to_string(pid) : "/proc/self";
+
+		stat_fd = ::open((dir + "/stat").c_str(), O_RDONLY | O_CLOEXEC);
+		statm_fd = ::open((dir + "/statm").c_str(), O_RDONLY | O_CLOEXEC);
+		status_fd = ::open((dir + "/status").c_str(), O_RDONLY | O_CLOEXEC);
+		io_fd = ::open((dir + "/io").c_str(), O_RDONLY | O_CLOEXEC);
+
+		page = sysconf(_SC_PAGESIZE);
+		hz = sysconf(_SC_CLK_TCK);
+	}
+
+	sampler(sampler const&) = delete;
+	sampler& operator=(sampler const&) = delete;
+
+	~sampler()
+	{
+		for(int fd : {stat_fd, statm_fd, status_fd, io_fd})
+			if (fd >= 0)
+				::close(fd);
+	}
+
+	// The process could be looked at when we started
+	bool ok() const
+	{
+		return stat_fd >= 0 && statm_fd >= 0;
+	}
+
+	sample take()
+	{
+		sample s;
+		s.time = clock::now();
+
+		// utime and stime are fields 14 and 15, counted after the
+		// command name, which may hold spaces and parentheses
+		if (read(stat_fd) > 0)
+			if (char const *p = std::strrchr(buf, ')')) {
+				for(int field = 2; field < 14 && p; ++field)
+					p = std::strchr(p + 1, ' ');
+				if (p) {
+					char *end;
+					s.cpu_ticks = std::strtoull(p + 1, &end, 10);
+					s.cpu_ticks += std::strtoull(end, nullptr, 10);
+					s.alive = true;
+				}
+			}
+
+		if (read(statm_fd) > 0) {
+			char *end;
+			std::strtoull(buf, &end, 10);
+			s.rss_bytes = std::strtoull(end, nullptr, 10) * page;
+		}
+
+		if (read(status_fd) > 0)
+			s.switches = field(buf, "voluntary_ctxt_switches:")
+			           + field(buf, "nonvoluntary_ctxt_switches:");
+
+		if (read(io_fd) > 0) {
+			s.has_io = true;
+			s.io_bytes = field(buf, "read_bytes:") + field(buf, "write_bytes:");
+		}
+
+		return s;
+	}
+
+	rates between(sample const& a, sample const& b) const
+	{
+		rates r;
+		double dt = std::chrono::duration<double>(b.time - a.time).count();
+		r.rss_bytes = double(b.rss_bytes);
+		r.has_io = a.has_io && b.has_io;
+		if (dt <= 0 || !b.alive)
+			return r;
+
+		r.cpu_percent = 100.0 * (b.cpu_ticks - a.cpu_ticks) / hz / dt;
+		r.switches = (b.switches - a.switches) / dt;
+		if (r.has_io)
+			r.io_bytes = (b.io_bytes - a.io_bytes) / dt;
+		return r;
+	}
+
+private:
+	int stat_fd{-1}, statm_fd{-1}, status_fd{-1}, io_fd{-1};
+	long page{4096};
+	long hz{100};
+
+	// status is the longest, at about 1.5 kB
+	char buf[4096];
+
+	ssize_t read(int fd)
+	{
+		if (fd < 0)
+			return -1;
+		auto n = ::pread(fd, buf, sizeof(buf) - 1, 0);
+		buf[n > 0 ? n : 0] = '\0';
+		return n;
+	}
+
+	// The number after "name" at the start of a line
+	static std::uint64_t field(char const *text, char const *name)
+	{
+		auto len = std::strlen(name);
+		for(char const *p = text; (p = std::strstr(p, name)); p += len)
+			if (p == text || p[-1] == '\n')
+				return std::strtoull(p + len, nullptr, 10);
+		return 0;
+	}
+};
+
+// Resident memory of this process in kB, for a look now and then
+inline long rss_kb()
+{
+	long pages = 0, resident = 0;
+	if (auto *f = std::fopen("/proc/self/statm", "r")) {
+		if (std::fscanf(f, "%ld %ld", &pages, &resident) != 2)
+			resident = 0;
+		std::fclose(f);
+	}
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// The last values of one metric, the oldest overwritten
+class series
+{
+public:
+	explicit series(std::size_t capacity)
+		: values(std::max<std::size_t>(capacity, 1))
+	{}
+
+	void add(float v)
+	{
+		values[added++ % values.size()] = v;
+	}
+
+	std::size_t capacity() const
+	{
+		return values.size();
+	}
+
+	// Values added so far; value n is kept while it is one of the last
+	// capacity()
+	std::uint64_t count() const
+	{
+		return added;
+	}
+
+	bool has(std::uint64_t n) const
+	{
+		return n < added && added - n <= values.size();
+	}
+
+	float at(std::uint64_t n) const
+	{
+		return values[n % values.size()];
+	}
+
+	// Largest of the kept values from n on
+	float max_from(std::uint64_t n) const
+	{
+		float m = 0;
+		for(; n < added; ++n)
+			if (has(n))
+				m = std::max(m, at(n));
+		return m;
+	}
+
+private:
+	std::vector<float> values;
+	std::uint64_t added{0};
+};
+
+}
+
+#endif // PROC_STATS_H
@@ -0,0 +1,369 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Terminal render-cost benchmark.  Runs one of the example programs
+// inside a pseudo-terminal, feeds it a scripted key sequence and
+// measures what it writes to the tty: bytes and escape sequences per
+// draw() and per output burst, plus the time spent in draw() as
+// reported through DRAW_STATS_FD (see draw_stats.h).
+//
+//   render_bench [--script tetris|hello] [--sizes 80x24,...]
+//                [--scales 4x2,...] [--settle-ms N] [--duration-ms N]
+//                [--json] -- program [args...]
+//
+// Every terminal size is combined with every scale; scales are reached
+// by typing the tetris x/X/y/Y keys and are ignored for hello.  Output
+// written during the settle period (start-up, initial paint, scale
+// changes) is reported separately from the measured period.
+//
+// Exits with status 1 if the program exits with an error in any run,
+// e.g. tetris --alloc-budget N over its allocation budget.
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+struct dims
+{
+	unsigned a{0}, b{0};
+};
+
+std::vector<dims> parse_dims(std::string const& list)
+{
+	std::vector<dims> out;
+	std::size_t pos = 0;
+
+	while(pos <= list.size()) {
+		auto end = list.find(',', pos);
+		if (end == std::string::npos)
+			end = list.size();
+
+		auto item = list.substr(pos, end - pos);
+		auto x = item.find('x');
+		if (x != std::string::npos)
+			out.push_back({ (unsigned)std::atoi(item.c_str()),
+			                (unsigned)std::atoi(item.c_str() + x + 1) });
+
+		pos = end + 1;
+	}
+
+	return out;
+}
+
+struct key_event
+{
+	int at_ms;
+	std::string keys;
+};
+
+// Scale keys go in during the settle period, the rest of the script
+// runs over the measured period and ends with 'q'.
+std::vector<key_event> make_script(std::string const& script, dims scale,
+                                   int settle_ms, int duration_ms)
+{
+	std::vector<key_event> ev;
+
+	if (script == "tetris") {
+		std::string keys;
+		for(unsigned s = 4; s > scale.a; --s) keys += 'x';
+		for(unsigned s = 4; s < scale.a; ++s) keys += 'X';
+		for(unsigned s = 2; s > scale.b; --s) keys += 'y';
+		for(unsigned s = 2; s < scale.b; ++s) keys += 'Y';
+		ev.push_back({settle_ms / 2, keys});
+
+		static const char *moves[] = { "a", "r", "d", "d", "a", " " };
+		int i = 0;
+		for(int t = settle_ms; t < settle_ms + duration_ms; t += 150)
+			ev.push_back({t, moves[i++ % 6]});
+	} else {
+		for(int t = settle_ms; t < settle_ms + duration_ms; t += 1000)
+			ev.push_back({t, "r"});
+	}
+
+	ev.push_back({settle_ms + duration_ms, "q"});
+
+	return ev;
+}
+
+struct result
+{
+	dims size, scale;
+
+	std::uint64_t startup_bytes{0};
+	std::uint64_t startup_draws{0};
+
+	std::uint64_t bytes{0};
+	std::uint64_t escapes{0};
+	std::uint64_t bursts{0};
+	std::uint64_t draws{0};
+	std::uint64_t draw_ns{0};
+	std::uint64_t draw_ns_max{0};
+
+	int status{0};
+};
+
+result run(std::vector<char*> const& argv, std::string const& script,
+           dims size, dims scale, int settle_ms, int duration_ms)
+{
+	result r;
+	r.size = size;
+	r.scale = scale;
+
+	int stats[2];
+	if (pipe(stats) == -1) {
+		std::perror("pipe");
+		std::exit(1);
+	}
+
+	winsize ws{};
+	ws.ws_col = size.a;
+	ws.ws_row = size.b;
+
+	int master = -1;
+	pid_t pid = forkpty(&master, nullptr, nullptr, &ws);
+	if (pid == -1) {
+		std::perror("forkpty");
+		std::exit(1);
+	}
+
+	if (pid == 0) {
+		close(stats[0]);
+		setenv("DRAW_STATS_FD", std::to_string(stats[1]).c_str(), 1);
+		if (!getenv("TERM"))
+			setenv("TERM", "xterm-256color", 1);
+
+		execvp(argv[0], argv.data());
+		_exit(127);
+	}
+
+	close(stats[1]);
+	fcntl(master, F_SETFL, O_NONBLOCK);
+	fcntl(stats[0], F_SETFL, O_NONBLOCK);
+
+	auto events = make_script(script, scale, settle_ms, duration_ms);
+	std::size_t next_event = 0;
+
+	auto start = clock::now();
+	auto deadline = start + std::chrono::milliseconds(settle_ms + duration_ms + 3000);
+	auto last_output = start;
+	auto since = [&](clock::time_point t) {
+		return (int)std::chrono::duration_cast<std::chrono::milliseconds>(t - start).count();
+	};
+
+	char buf[65536];
+	unsigned char pending[sizeof(std::uint64_t)];
+	std::size_t pending_len = 0;
+
+	bool tty_open = true, stats_open = true;
+
+	while((tty_open || stats_open) && clock::now() < deadline) {
+		int timeout = 50;
+		if (next_event < events.size())
+			timeout = std::max(0, std::min(timeout, events[next_event].at_ms - since(clock::now())));
+
+		pollfd fds[2] = {
+			{ tty_open ? master : -1, POLLIN, 0 },
+			{ stats_open ? stats[0] : -1, POLLIN, 0 }
+		};
+		poll(fds, 2, timeout);
+
+		auto now = clock::now();
+		bool measuring = since(now) >= settle_ms;
+
+		if (fds[0].revents) {
+			ssize_t n = read(master, buf, sizeof(buf));
+			if (n > 0) {
+				if (!measuring)
+					r.startup_bytes += n;
+				else {
+					// output more than 2 ms after the previous chunk
+					// starts a new burst
+					if (now - last_output > std::chrono::milliseconds(2) || r.bursts == 0)
+						++r.bursts;
+
+					r.bytes += n;
+					for(ssize_t i = 0; i < n; ++i)
+						r.escapes += buf[i] == '\033';
+				}
+				last_output = now;
+			} else if (n == 0 || errno != EAGAIN)
+				tty_open = false;
+		}
+
+		if (fds[1].revents) {
+			ssize_t n = read(stats[0], buf, sizeof(buf));
+			if (n > 0) {
+				for(ssize_t i = 0; i < n; ++i) {
+					pending[pending_len++] = buf[i];
+					if (pending_len < sizeof(pending))
+						continue;
+
+					std::uint64_t ns;
+					std::memcpy(&ns, pending, sizeof(ns));
+					pending_len = 0;
+
+					if (!measuring) {
+						++r.startup_draws;
+						continue;
+					}
+
+					++r.draws;
+					r.draw_ns += ns;
+					r.draw_ns_max = std::max(r.draw_ns_max, ns);
+				}
+			} else if (n == 0 || errno != EAGAIN)
+				stats_open = false;
+		}
+
+		while(next_event < events.size() && events[next_event].at_ms <= since(now)) {
+			auto const& keys = events[next_event++].keys;
+			for(char c : keys) {
+				// one key per write so each arrives as its own key press
+				ssize_t n = write(master, &c, 1);
+				(void)n;
+				usleep(1000);
+			}
+		}
+	}
+
+	if (tty_open || stats_open)
+		kill(pid, SIGKILL);
+
+	waitpid(pid, &r.status, 0);
+	close(master);
+	close(stats[0]);
+
+	return r;
+}
+
+double per(std::uint64_t a, std::uint64_t b)
+{
+	return b ? double(a) / b : 0.0;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	std::string script;
+	std::string sizes = "80x24,120x40,200x60";
+	std::string scales = "4x2,2x1,1x1";
+	int settle_ms = 1500;
+	int duration_ms = 5000;
+	bool json = false;
+
+	std::vector<char*> cmd;
+
+	for(int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+
+		if (arg == "--script" && i + 1 < argc)
+			script = argv[++i];
+		else if (arg == "--sizes" && i + 1 < argc)
+			sizes = argv[++i];
+		else if (arg == "--scales" && i + 1 < argc)
+			scales = argv[++i];
+		else if (arg == "--settle-ms" && i + 1 < argc)
+			settle_ms = std::atoi(argv[++i]);
+		else if (arg == "--duration-ms" && i + 1 < argc)
+			duration_ms = std::atoi(argv[++i]);
+		else if (arg == "--json")
+			json = true;
+		else if (arg == "--") {
+			cmd.assign(argv + i + 1, argv + argc);
+			break;
+		} else {
+			cmd.clear();
+			break;
+		}
+	}
+
+	if (cmd.empty()) {
+		std::cerr << "usage: " << argv[0]
+		          << " [--script tetris|hello] [--sizes 80x24,...] [--scales 4x2,...]"
+		          << " [--settle-ms N] [--duration-ms N] [--json] -- program [args...]\n";
+		return 2;
+	}
+
+	cmd.push_back(nullptr);
+
+	if (script.empty())
+		script = std::string(cmd[0]).find("tetris") != std::string::npos ? "tetris" : "hello";
+
+	auto size_list = parse_dims(sizes);
+	auto scale_list = script == "tetris" ? parse_dims(scales) : std::vector<dims>{{1, 1}};
+
+	std::vector<result> results;
+	for(auto size : size_list)
+		for(auto scale : scale_list)
+			results.push_back(run(cmd, script, size, scale, settle_ms, duration_ms));
+
+	bool failed = false;
+	for(auto const& r : results)
+		if (WIFEXITED(r.status) && WEXITSTATUS(r.status) != 0) {
+			std::cerr << cmd[0] << " exited with status " << WEXITSTATUS(r.status)
+			          << " at " << r.size.a << "x" << r.size.b << "\n";
+			failed = true;
+		}
+
+	if (json) {
+		std::cout << "{\n  \"program\": \"" << cmd[0] << "\""
+		          << ",\n  \"script\": \"" << script << "\""
+		          << ",\n  \"duration_ms\": " << duration_ms
+		          << ",\n  \"runs\": [";
+
+		const char *sep = "\n";
+		for(auto const& r : results) {
+			std::cout << sep << "    {\"cols\": " << r.size.a
+			          << ", \"rows\": " << r.size.b
+			          << ", \"scale_x\": " << r.scale.a
+			          << ", \"scale_y\": " << r.scale.b
+			          << ", \"startup_bytes\": " << r.startup_bytes
+			          << ", \"startup_draws\": " << r.startup_draws
+			          << ", \"bytes\": " << r.bytes
+			          << ", \"escapes\": " << r.escapes
+			          << ", \"bursts\": " << r.bursts
+			          << ", \"draws\": " << r.draws
+			          << ", \"draw_ns\": " << r.draw_ns
+			          << ", \"draw_ns_max\": " << r.draw_ns_max
+			          << ", \"exit_status\": " << r.status << "}";
+			sep = ",\n";
+		}
+
+		std::cout << "\n  ]\n}\n";
+		return failed ? 1 : 0;
+	}
+
+	std::cout << std::setw(9) << "terminal" << std::setw(7) << "scale"
+	          << std::setw(9) << "draws" << std::setw(12) << "bytes/draw"
+	          << std::setw(11) << "esc/draw" << std::setw(13) << "bytes/burst"
+	          << std::setw(12) << "us/draw" << std::setw(12) << "max us" << "\n";
+
+	for(auto const& r : results) {
+		std::string term = std::to_string(r.size.a) + "x" + std::to_string(r.size.b);
+		std::string scale = std::to_string(r.scale.a) + "x" + std::to_string(r.scale.b);
+
+		std::cout << std::setw(9) << term << std::setw(7) << scale
+		          << std::setw(9) << r.draws
+		          << std::fixed << std::setprecision(1)
+		          << std::setw(12) << per(r.bytes, r.draws)
+		          << std::setw(11) << per(r.escapes, r.draws)
+		          << std::setw(13) << per(r.bytes, r.bursts)
+		          << std::setw(12) << per(r.draw_ns, r.draws) / 1000
+		          << std::setw(12) << r.draw_ns_max / 1000.0 << "\n";
+	}
+
+	return failed ? 1 : 0;
+}
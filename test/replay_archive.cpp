@@ -0,0 +1,280 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "autoplay.h"
+#include "dataset.h"
+#include "replay_archive.h"
+#include "worker_pool.h"
+
+// Tool for replay archives (see replay_archive.h).
+//
+//   replay_archive DIR generate N [--threads N] [--pieces N] [--seed N]
+//   replay_archive DIR top N
+//   replay_archive DIR find [--seed N] [--min-score N] [--min-lines N]
+//   replay_archive DIR scan [--threads N] [--seed N] [--min-score N] [--min-lines N]
+//   replay_archive DIR export FILE [--seed N] [--min-score N] [--min-lines N]
+//
+// generate appends N games of the greedy bot, seeds counting up from
+// --seed, each stopped after --pieces pieces if it has not ended.  top
+// prints the leaderboard, find the games matching the filters, scan
+// replays them on all cores and prints the totals, and export replays
+// them into a training data file (see dataset.h), one sample per input.
+// tetris --archive DIR adds the games played by hand.
+
+namespace {
+
+struct filter
+{
+	long seed{-1};
+	long min_score{0};
+	long min_lines{0};
+
+	bool operator()(game::index_entry const& e) const
+	{
+		return (seed < 0 || e.seed == std::uint32_t(seed))
+		    && e.score >= min_score
+		    && e.lines >= std::uint32_t(min_lines);
+	}
+};
+
+void print_entry(game::index_entry const& e)
+{
+	std::cout << "#" << e.id << "  score " << e.score << "  lines " << e.lines
+	          << "  pieces " << e.pieces << "  seed " << e.seed
+	          << "  " << e.duration_ms << " ms\n";
+}
+
+int generate(std::string const& dir, long games, std::size_t threads,
+             long pieces, long seed)
+{
+	game::archive_writer writer(dir);
+	if (!writer.ok()) {
+		std::cerr << "cannot open archive " << dir << "\n";
+		return 1;
+	}
+
+	std::mutex m;
+	long next = 0;
+
+	auto start = std::chrono::steady_clock::now();
+
+	worker_pool pool(threads);
+	pool.run([&](std::size_t) {
+		game::move_generator gen;
+		game::replay_recorder rec;
+
+		for(;;) {
+			long game;
+			{
+				std::lock_guard<std::mutex> lock(m);
+				if (next == games)
+					return;
+				game = next++;
+			}
+
+			game::engine eng{10, 20, std::uint32_t(seed + game)};
+			eng.reset();
+			rec.start(eng);
+
+			long placed = 0;
+			while(!eng.game_over && placed < pieces) {
+				if (eng.active_piece && eng.active_piece->orig_y == 2) {
+					if (auto best = game::best_landing(gen, eng))
+						gen.play(eng, *best, [&](game::move mv) { rec.add(mv); });
+					++placed;
+				}
+
+				// let the piece fall until it locks
+				rec.update(eng);
+			}
+
+			std::lock_guard<std::mutex> lock(m);
+			writer.append(rec, eng);
+		}
+	});
+
+	auto dur = std::chrono::steady_clock::now() - start;
+	std::cout << games << " games in "
+	          << std::chrono::duration_cast<std::chrono::milliseconds>(dur).count()
+	          << " ms\n";
+
+	return writer.ok() ? 0 : 1;
+}
+
+// Games of another board size than the first one exported are skipped
+int export_games(game::archive_reader const& archive, filter const& f,
+                 std::string const& path)
+{
+	auto games = archive.find(f);
+	if (games.empty()) {
+		std::cerr << "no games to export\n";
+		return 1;
+	}
+
+	auto const *first = archive.start(*games[0]);
+	if (!first) {
+		std::cerr << "game " << games[0]->id << " is damaged\n";
+		return 1;
+	}
+
+	game::dataset_writer out(path, first->width, first->height);
+	game::engine eng;
+	long skipped = 0;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for(auto const *e : games) {
+		auto const *s = archive.start(*e);
+		if (!s || s->width != first->width || s->height != first->height) {
+			++skipped;
+			continue;
+		}
+
+		// a sample is committed once the next input shows what its own
+		// input earned
+		bool open = false;
+		int score = 0;
+		game::action act = game::action::none;
+
+		auto before = [&](game::engine const& cur, game::move m) {
+			if (open)
+				out.commit(act, cur.score - score);
+			out.observe(cur);
+			act = game::to_action(m);
+			score = cur.score;
+			open = true;
+		};
+
+		archive.replay(*e, eng, before, [](std::size_t) {});
+		if (open)
+			out.commit(act, eng.score - score);
+	}
+
+	auto samples = out.samples();
+	out.close();
+
+	auto dur = std::chrono::steady_clock::now() - start;
+	auto us = std::chrono::duration_cast<std::chrono::microseconds>(dur).count();
+
+	std::cout << samples << " samples of " << games.size() - skipped << " games in "
+	          << us / 1000 << " ms, " << (samples ? us * 1000.0 / samples : 0.0)
+	          << " ns per sample";
+	if (skipped)
+		std::cout << ", " << skipped << " games of other sizes skipped";
+	std::cout << "\n";
+
+	if (!out.ok()) {
+		std::cerr << "cannot write " << path << "\n";
+		return 1;
+	}
+
+	return 0;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	auto usage = [&] {
+		std::cerr << "usage: " << argv[0] << " DIR generate N [--threads N] [--pieces N] [--seed N]\n"
+		          << "       " << argv[0] << " DIR top N\n"
+		          << "       " << argv[0] << " DIR find|scan [--threads N] [--seed N]"
+		          << " [--min-score N] [--min-lines N]\n"
+		          << "       " << argv[0] << " DIR export FILE [--seed N]"
+		          << " [--min-score N] [--min-lines N]\n";
+		return 2;
+	};
+
+	if (argc < 3)
+		return usage();
+
+	std::string dir = argv[1];
+	std::string command = argv[2];
+	std::string file;
+	long n = 0;
+	int i = 3;
+
+	if ((command == "generate" || command == "top") && i < argc)
+		n = std::atol(argv[i++]);
+	else if (command == "export" && i < argc)
+		file = argv[i++];
+
+	std::size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+	long pieces = 1000;
+	long seed = 1;
+	filter f;
+
+	for(; i < argc; ++i) {
+		std::string arg = argv[i];
+
+		if (arg == "--threads" && i + 1 < argc)
+			threads = std::atol(argv[++i]);
+		else if (arg == "--pieces" && i + 1 < argc)
+			pieces = std::atol(argv[++i]);
+		else if (arg == "--seed" && i + 1 < argc)
+			seed = f.seed = std::atol(argv[++i]);
+		else if (arg == "--min-score" && i + 1 < argc)
+			f.min_score = std::atol(argv[++i]);
+		else if (arg == "--min-lines" && i + 1 < argc)
+			f.min_lines = std::atol(argv[++i]);
+		else
+			return usage();
+	}
+
+	if (command == "generate")
+		return generate(dir, n, threads, pieces, seed);
+
+	game::archive_reader archive(dir);
+	if (!archive.ok()) {
+		std::cerr << "cannot open archive " << dir << "\n";
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	auto elapsed_us = [&] {
+		auto dur = std::chrono::steady_clock::now() - start;
+		return std::chrono::duration_cast<std::chrono::microseconds>(dur).count();
+	};
+
+	if (command == "top") {
+		auto best = archive.top(n);
+		auto us = elapsed_us();
+
+		for(auto const *e : best)
+			print_entry(*e);
+		std::cerr << archive.size() << " games, " << us << " us\n";
+	} else if (command == "find") {
+		auto found = archive.find(f);
+		auto us = elapsed_us();
+
+		for(auto const *e : found)
+			print_entry(*e);
+		std::cerr << found.size() << " of " << archive.size() << " games, "
+		          << us << " us\n";
+	} else if (command == "scan") {
+		auto st = archive.scan(f, threads);
+		auto us = elapsed_us();
+
+		std::cout << st.games << " games replayed on " << threads << " threads in "
+		          << us / 1000 << " ms\n"
+		          << "  pieces " << st.pieces << ", moves " << st.moves
+		          << ", lines " << st.lines << "\n"
+		          << "  clears: single " << st.clears[1] << ", double " << st.clears[2]
+		          << ", triple " << st.clears[3] << ", tetris " << st.clears[4] << "\n"
+		          << "  score: max " << st.max_score << ", mean "
+		          << (st.games ? double(st.total_score) / st.games : 0.0) << "\n"
+		          << "  mismatches " << st.mismatches << ", damaged " << st.damaged << "\n";
+
+		return st.mismatches || st.damaged ? 1 : 0;
+	} else if (command == "export" && !file.empty()) {
+		return export_games(archive, f, file);
+	} else {
+		return usage();
+	}
+
+	return 0;
+}
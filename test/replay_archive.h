@@ -0,0 +1,512 @@
+#ifndef REPLAY_ARCHIVE_H
+#define REPLAY_ARCHIVE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "movegen.h"
+#include "snapshot.h"
+#include "tetris_engine.h"
+#include "worker_pool.h"
+
+namespace game {
+
+// Archive of finished games, kept in a directory:
+//
+//   seg-000000.dat ...  games, appended one after another
+//   index.dat           one fixed size entry per game
+//
+// A game is stored as the snapshot it started from and the inputs that
+// followed, one byte each (a game::move, down being a gravity tick), so
+// replaying it through the engine gives the same game again.  Segments
+// are closed at a size limit and a new one is started; nothing is ever
+// rewritten.
+//
+// The index is written after the game it points to, so an entry always
+// refers to a complete record.  It is an array of index_entry behind a
+// small header and is mapped and queried in place.  Records and entries
+// are in native byte order.
+struct index_entry
+{
+	std::uint64_t id;
+	std::uint64_t offset;      // of the record in its segment
+	std::uint32_t segment;
+	std::uint32_t seed;
+	std::int32_t score;
+	std::uint32_t lines;
+	std::uint32_t pieces;
+	std::uint32_t duration_ms;
+	std::uint32_t moves;
+	std::uint32_t reserved;
+};
+
+static_assert(sizeof(index_entry) == 48, "index layout changed, bump its version");
+
+struct index_header
+{
+	static constexpr std::uint32_t magic_value = 0x58495254;  // "TRIX"
+	static constexpr std::uint32_t current_version = 1;
+
+	std::uint32_t magic;
+	std::uint32_t version;
+	std::uint64_t reserved;
+};
+
+struct record_header
+{
+	static constexpr std::uint32_t magic_value = 0x4c505254;  // "TRPL"
+
+	std::uint32_t magic;
+	std::uint32_t moves;
+	std::uint64_t id;
+
+	// followed by the start snapshot and the moves, padded to 8 bytes
+};
+
+inline std::size_t record_size(std::uint32_t moves)
+{
+	return sizeof(record_header) + sizeof(snapshot) + (moves + 7) / 8 * 8;
+}
+
+inline std::string segment_path(std::string const& dir, std::uint32_t segment)
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "/seg-%06u.dat", segment);
+	return dir + name;
+}
+
+inline std::string index_path(std::string const& dir)
+{
+	return dir + "/index.dat";
+}
+
+// Inputs of one game as it is played.  Key presses go through add(),
+// gravity through update(), which also counts pieces and lines.
+class replay_recorder
+{
+public:
+	// Begin a new recording from the engine's current state
+	void start(engine const& eng)
+	{
+		first = take_snapshot(eng);
+		moves.clear();
+
+		// room for a long game up front, so that recording it does not
+		// allocate while it is played
+		moves.reserve(1 << 16);
+		lines = pieces = 0;
+		started = std::chrono::steady_clock::now();
+		active = true;
+	}
+
+	bool recording() const
+	{
+		return active;
+	}
+
+	void add(move m)
+	{
+		if (active)
+			moves.push_back(std::uint8_t(m));
+	}
+
+	cleared_rows update(engine& eng)
+	{
+		bool spawning = !eng.active_piece;
+		auto cleared = eng.update();
+
+		if (active) {
+			moves.push_back(std::uint8_t(move::down));
+			lines += cleared.size();
+			pieces += spawning && eng.active_piece;
+		}
+
+		return cleared;
+	}
+
+	// Stop recording, e.g. after the engine was changed behind its back
+	void stop()
+	{
+		active = false;
+	}
+
+private:
+	friend class archive_writer;
+
+	snapshot first{};
+	std::vector<std::uint8_t> moves;
+	std::uint32_t lines{0}, pieces{0};
+	std::chrono::steady_clock::time_point started;
+	bool active{false};
+};
+
+// Appends games to an archive directory, which must exist.  Opening it
+// again continues after the last complete entry; a torn entry at the end
+// of the index is cut off.
+class archive_writer
+{
+public:
+	explicit archive_writer(std::string const& d,
+	                        std::uint64_t limit = 64ull << 20)
+		: dir(d)
+		, segment_limit(limit)
+	{
+		auto path = index_path(dir);
+		std::uint64_t entries = 0;
+
+		{
+			mapped_file file(path);
+			auto const *h = reinterpret_cast<index_header const *>(file.data());
+
+			if (file.size() >= sizeof(index_header)
+			    && h->magic == index_header::magic_value
+			    && h->version == index_header::current_version) {
+				entries = (file.size() - sizeof(index_header)) / sizeof(index_entry);
+
+				if (entries) {
+					auto const& last = reinterpret_cast<index_entry const *>(
+						file.data() + sizeof(index_header))[entries - 1];
+					next_id = last.id + 1;
+					segment = last.segment;
+				}
+			} else if (file.size() > 0) {
+				// not an index of ours, leave it alone
+				return;
+			}
+		}
+
+		if (entries == 0) {
+			index_header h{index_header::magic_value, index_header::current_version, 0};
+			std::ofstream out(path, std::ios::binary | std::ios::trunc);
+			out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+			if (!out.flush())
+				return;
+		}
+
+		index.open(path, std::ios::binary | std::ios::in | std::ios::out);
+		index.seekp(sizeof(index_header) + entries * sizeof(index_entry));
+
+		open_segment();
+	}
+
+	bool ok() const
+	{
+		return index.is_open() && data.is_open() && index.good() && data.good();
+	}
+
+	// Store a recorded game that ended in eng, returning its id
+	std::uint64_t append(replay_recorder const& rec, engine const& eng)
+	{
+		auto elapsed = std::chrono::steady_clock::now() - rec.started;
+
+		index_entry e{};
+		e.id = next_id;
+		e.seed = rec.first.seed;
+		e.score = eng.score;
+		e.lines = rec.lines;
+		e.pieces = rec.pieces;
+		e.duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+		e.moves = rec.moves.size();
+
+		if (offset > 0 && offset + record_size(e.moves) > segment_limit) {
+			++segment;
+			open_segment();
+		}
+
+		e.segment = segment;
+		e.offset = offset;
+
+		record_header h{record_header::magic_value, e.moves, e.id};
+		static const char pad[8]{};
+
+		data.write(reinterpret_cast<const char *>(&h), sizeof(h));
+		data.write(reinterpret_cast<const char *>(&rec.first), sizeof(snapshot));
+		data.write(reinterpret_cast<const char *>(rec.moves.data()), e.moves);
+		data.write(pad, record_size(e.moves) - sizeof(h) - sizeof(snapshot) - e.moves);
+		data.flush();
+
+		index.write(reinterpret_cast<const char *>(&e), sizeof(e));
+		index.flush();
+
+		offset += record_size(e.moves);
+
+		return next_id++;
+	}
+
+private:
+	std::string dir;
+	std::uint64_t segment_limit;
+
+	std::fstream index;
+	std::ofstream data;
+	std::uint32_t segment{0};
+	std::uint64_t offset{0};
+	std::uint64_t next_id{0};
+
+	void open_segment()
+	{
+		data.close();
+		data.clear();
+		data.open(segment_path(dir, segment), std::ios::binary | std::ios::app);
+		data.seekp(0, std::ios::end);
+		offset = data.tellp();
+
+		// records start 8 byte aligned even after a torn write
+		offset = (offset + 7) / 8 * 8;
+		static const char pad[8]{};
+		data.write(pad, offset - std::uint64_t(data.tellp()));
+	}
+};
+
+// What replaying a game gave; ok is false for a damaged record.
+struct replay_result
+{
+	bool ok{false};
+	int score{0};
+	std::uint32_t lines{0};
+	std::uint32_t pieces{0};
+	std::uint32_t moves{0};
+};
+
+// Aggregate of many replays.  mismatches counts games whose replay did
+// not end with the score and lines the index has.
+struct scan_stats
+{
+	std::uint64_t games{0};
+	std::uint64_t moves{0};
+	std::uint64_t pieces{0};
+	std::uint64_t lines{0};
+	std::uint64_t mismatches{0};
+	std::uint64_t damaged{0};
+	std::int64_t total_score{0};
+	int max_score{0};
+
+	// clears by the number of lines cleared at once
+	std::uint64_t clears[5]{};
+
+	scan_stats& operator+=(scan_stats const& o)
+	{
+		games += o.games;
+		moves += o.moves;
+		pieces += o.pieces;
+		lines += o.lines;
+		mismatches += o.mismatches;
+		damaged += o.damaged;
+		total_score += o.total_score;
+		max_score = std::max(max_score, o.max_score);
+		for(int i = 0; i < 5; ++i)
+			clears[i] += o.clears[i];
+
+		return *this;
+	}
+};
+
+// An archive mapped read-only.  It sees the games that were complete
+// when it was opened; the index and the segments are used in place and
+// may be read from any number of threads.
+class archive_reader
+{
+public:
+	explicit archive_reader(std::string const& dir)
+		: index(index_path(dir))
+	{
+		auto const *h = reinterpret_cast<index_header const *>(index.data());
+		if (index.size() < sizeof(index_header)
+		    || h->magic != index_header::magic_value
+		    || h->version != index_header::current_version)
+			return;
+
+		first = reinterpret_cast<index_entry const *>(index.data() + sizeof(index_header));
+		count = (index.size() - sizeof(index_header)) / sizeof(index_entry);
+
+		// segments after the index, so they hold every record it lists
+		std::uint32_t last = count ? first[count - 1].segment : 0;
+		for(std::uint32_t s = 0; s <= last; ++s)
+			segments.emplace_back(segment_path(dir, s));
+	}
+
+	bool ok() const
+	{
+		return first != nullptr;
+	}
+
+	std::size_t size() const
+	{
+		return count;
+	}
+
+	index_entry const *begin() const
+	{
+		return first;
+	}
+
+	index_entry const *end() const
+	{
+		return first + count;
+	}
+
+	index_entry const& operator[](std::size_t i) const
+	{
+		return first[i];
+	}
+
+	// The n entries with the highest score, best first
+	std::vector<index_entry const *> top(std::size_t n) const
+	{
+		return top(n, [](index_entry const&) { return true; });
+	}
+
+	template <typename Pred>
+	std::vector<index_entry const *> top(std::size_t n, Pred&& pred) const
+	{
+		auto found = find(pred);
+		n = std::min(n, found.size());
+
+		std::partial_sort(found.begin(), found.begin() + n, found.end(),
+		                  [](index_entry const *a, index_entry const *b) {
+		                      return a->score > b->score
+		                          || (a->score == b->score && a->id < b->id);
+		                  });
+		found.resize(n);
+
+		return found;
+	}
+
+	// Every entry pred accepts, in archive order
+	template <typename Pred>
+	std::vector<index_entry const *> find(Pred&& pred) const
+	{
+		std::vector<index_entry const *> found;
+		for(auto const& e : *this)
+			if (pred(e))
+				found.push_back(&e);
+
+		return found;
+	}
+
+	// Start snapshot of a game, nullptr if its record is damaged
+	snapshot const *start(index_entry const& e) const
+	{
+		auto const *h = header(e);
+		return h ? reinterpret_cast<snapshot const *>(h + 1) : nullptr;
+	}
+
+	// Replay a game in eng; before is called with the engine and every
+	// input ahead of it, on_clear with the number of lines of every clear
+	template <typename B, typename F>
+	replay_result replay(index_entry const& e, engine& eng, B&& before, F&& on_clear) const
+	{
+		replay_result r;
+
+		auto const *h = header(e);
+		if (!h || !restore(*reinterpret_cast<snapshot const *>(h + 1), eng))
+			return r;
+
+		auto const *moves = reinterpret_cast<std::uint8_t const *>(h + 1) + sizeof(snapshot);
+
+		for(std::uint32_t i = 0; i < h->moves; ++i) {
+			bool spawning = !eng.active_piece;
+			auto m = move(moves[i]);
+
+			before(eng, m);
+			auto cleared = apply(eng, m);
+
+			r.pieces += m == move::down && spawning && eng.active_piece;
+			if (!cleared.empty()) {
+				r.lines += cleared.size();
+				on_clear(cleared.size());
+			}
+		}
+
+		r.ok = true;
+		r.score = eng.score;
+		r.moves = h->moves;
+
+		return r;
+	}
+
+	replay_result replay(index_entry const& e, engine& eng) const
+	{
+		return replay(e, eng, [](engine const&, move) {}, [](std::size_t) {});
+	}
+
+	// Replay every game pred accepts on the given number of threads and
+	// add up what came out
+	template <typename Pred>
+	scan_stats scan(Pred&& pred, std::size_t threads) const
+	{
+		worker_pool pool(threads);
+		std::vector<scan_stats> part(pool.size());
+
+		pool.run([&](std::size_t w) {
+			// contiguous ranges keep every thread in its own part of the
+			// index and mostly in its own segments
+			auto from = count * w / pool.size();
+			auto to = count * (w + 1) / pool.size();
+
+			engine eng;
+			auto& st = part[w];
+
+			for(auto i = from; i < to; ++i) {
+				auto const& e = first[i];
+				if (!pred(e))
+					continue;
+
+				auto r = replay(e, eng, [](engine const&, move) {}, [&](std::size_t n) {
+					++st.clears[std::min<std::size_t>(n, 4)];
+				});
+
+				if (!r.ok) {
+					++st.damaged;
+					continue;
+				}
+
+				++st.games;
+				st.moves += r.moves;
+				st.pieces += r.pieces;
+				st.lines += r.lines;
+				st.total_score += r.score;
+				st.max_score = std::max(st.max_score, r.score);
+				st.mismatches += r.score != e.score || r.lines != e.lines;
+			}
+		});
+
+		scan_stats total;
+		for(auto const& st : part)
+			total += st;
+
+		return total;
+	}
+
+private:
+	mapped_file index;
+	std::vector<mapped_file> segments;
+	index_entry const *first{nullptr};
+	std::size_t count{0};
+
+	record_header const *header(index_entry const& e) const
+	{
+		if (e.segment >= segments.size())
+			return nullptr;
+
+		auto const& seg = segments[e.segment];
+		if (e.offset + record_size(e.moves) > seg.size())
+			return nullptr;
+
+		auto const *h = reinterpret_cast<record_header const *>(seg.data() + e.offset);
+		if (h->magic != record_header::magic_value || h->id != e.id || h->moves != e.moves)
+			return nullptr;
+
+		return h;
+	}
+};
+
+}
+
+#endif // REPLAY_ARCHIVE_H
@@ -0,0 +1,225 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "autoplay.h"
+#include "board_features.h"
+#include "movegen.h"
+#include "tetris_engine.h"
+
+namespace game {
+
+// Lookahead bot: expectimax over the coming pieces.
+//
+// The active piece and next_piece are known, and so are options.preview
+// more pieces, as a game showing a longer preview would.  Every piece
+// after those is a chance node averaging over the seven kinds.  Only the
+// options.beam best landings of each piece by the greedy heuristic are
+// searched further.
+//
+// search() deepens one piece at a time until options.depth or the time
+// budget is reached and returns the best move of the deepest search that
+// finished.  Boards are bitboards; the candidates of every node live in
+// one arena that grows like a stack and keeps its storage between
+// searches, so a search does not allocate once it has warmed up.
+struct search_options
+{
+	int depth{3};      // pieces to place, the active one included
+	int preview{0};    // known pieces after next_piece
+	int beam{5};       // landings followed per piece
+	std::chrono::microseconds budget{100000};
+};
+
+class searcher
+{
+public:
+	search_options options;
+
+	struct result
+	{
+		landing const *best{nullptr};
+		int depth{0};
+		double value{0};
+		std::size_t nodes{0};
+	};
+
+	searcher()
+	{
+		for(std::uint32_t k = 0; k < kinds.size(); ++k)
+			kinds[k] = engine::make_piece(k);
+	}
+
+	// Best landing for the engine's active piece; it points into the
+	// searcher and stays valid until the next search.
+	result search(engine const& eng)
+	{
+		result res;
+
+		if (!eng.active_piece)
+			return res;
+
+		deadline = std::chrono::steady_clock::now() + options.budget;
+		nodes = 0;
+		best_index = -1;
+
+		known.clear();
+		known.push_back(eng.next_piece.get());
+		for(int i = 0; i < options.preview; ++i)
+			known.push_back(kinds[eng.peek_kind(i)].get());
+
+		spawn_x = eng.width / 2;
+
+		// the first depth always completes, so there is a move
+		for(int depth = 1; depth <= std::max(options.depth, 1); ++depth) {
+			timed_out = false;
+			limit = depth;
+
+			int index = -1;
+			double value = root(eng, index);
+
+			if (timed_out && depth > 1)
+				break;
+
+			res.depth = depth;
+			res.value = value;
+			best_index = index;
+		}
+
+		res.nodes = nodes;
+
+		// the deeper levels reused the generator, search the root again
+		// for the paths
+		gen.generate(eng);
+		if (best_index >= 0)
+			res.best = &gen[best_index];
+
+		return res;
+	}
+
+	// Move the active piece to a landing from search(), see
+	// move_generator::play()
+	void play(engine& eng, landing const& l) const
+	{
+		gen.play(eng, l);
+	}
+
+	// The inputs leading to a landing, see move_generator::path()
+	std::size_t path(landing const& l, move *out, std::size_t max) const
+	{
+		return gen.path(l, out, max);
+	}
+
+private:
+	struct candidate
+	{
+		bitboard board;
+		int lines;
+		int index;
+		double score;
+	};
+
+	move_generator gen;
+	std::array<std::unique_ptr<piece>, 7> kinds;
+	std::vector<piece const *> known;
+	std::vector<candidate> arena;
+
+	std::chrono::steady_clock::time_point deadline;
+	bool timed_out{false};
+	int limit{1};
+	int spawn_x{0};
+	int best_index{-1};
+	std::size_t nodes{0};
+
+	static constexpr double lost = -1e6;
+
+	double root(engine const& eng, int& index)
+	{
+		gen.generate(eng);
+		++nodes;
+
+		return expand(0, 0, index);
+	}
+
+	// Value of placing piece level on the board of the last generate()
+	double place(bitboard const& b, piece const& p, int level, int lines)
+	{
+		if (std::chrono::steady_clock::now() > deadline)
+			timed_out = true;
+
+		if (timed_out)
+			return lost;
+
+		gen.generate(b, p, spawn_x, 2);
+		++nodes;
+
+		int index;
+		return expand(level, lines, index);
+	}
+
+	double expand(int level, int lines, int& index)
+	{
+		index = -1;
+		if (gen.size() == 0)
+			return lost;
+
+		// score every landing, keep the best few on the arena
+		auto mark = arena.size();
+		for(std::size_t i = 0; i < gen.size(); ++i) {
+			candidate c{gen.board(), 0, int(i), 0};
+			gen.place(gen[i], c.board);
+			c.lines = clear_lines(c.board);
+			c.score = evaluate_board(c.board, lines + c.lines);
+			arena.push_back(c);
+		}
+
+		auto first = arena.begin() + mark;
+		auto keep = std::min<std::size_t>(std::max(options.beam, 1), gen.size());
+		std::partial_sort(first, first + keep, arena.end(),
+		                  [](candidate const& a, candidate const& b) {
+		                      return a.score > b.score;
+		                  });
+		arena.resize(mark + keep);
+
+		double best = -std::numeric_limits<double>::infinity();
+
+		for(std::size_t i = 0; i < keep; ++i) {
+			// the arena may move while children push onto it
+			auto c = arena[mark + i];
+			double v = level + 1 >= limit ? c.score
+			                              : value(c.board, level + 1, lines + c.lines);
+
+			if (v > best) {
+				best = v;
+				index = c.index;
+			}
+		}
+
+		arena.resize(mark);
+
+		return best;
+	}
+
+	// Value of a board before piece level is placed
+	double value(bitboard const& b, int level, int lines)
+	{
+		std::size_t k = level - 1;
+		if (k < known.size())
+			return place(b, *known[k], level, lines);
+
+		double sum = 0;
+		for(auto& p : kinds)
+			sum += place(b, *p, level, lines);
+
+		return sum / kinds.size();
+	}
+};
+
+}
+
+#endif // SEARCH_H
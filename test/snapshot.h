@@ -0,0 +1,340 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "mapped_file.h"
+#include "tetris_engine.h"
+
+namespace game {
+
+// A piece in 9 bytes: id (0 for none), origin, and the block offsets of
+// its current rotation.
+struct piece_record
+{
+	std::int8_t id{0};
+	std::int8_t x{0}, y{0};
+	std::int8_t blocks[3][2]{};
+};
+
+inline piece_record save_piece(piece const *p)
+{
+	piece_record r;
+	if (!p)
+		return r;
+
+	r.id = p->id;
+	r.x = p->orig_x;
+	r.y = p->orig_y;
+	for(int b = 0; b < 3; ++b) {
+		r.blocks[b][0] = p->blocks[b].first;
+		r.blocks[b][1] = p->blocks[b].second;
+	}
+
+	return r;
+}
+
+// The piece of a record, null for none and for an id or rotation no
+// piece of the engine has.  Given an engine, one of its spare pieces is
+// used when it has one (see engine::new_piece()).
+inline std::unique_ptr<piece> load_piece(piece_record const& r, engine *spares = nullptr)
+{
+	if (!r.id)
+		return nullptr;
+
+	auto kind = engine::kind_of(r.id);
+	auto p = spares ? spares->new_piece(kind) : engine::make_piece(kind);
+	if (p->id != r.id)
+		return nullptr;
+
+	// turn the fresh piece until it matches the recorded rotation
+	for(int turn = 0; turn < 4; ++turn) {
+		bool same = true;
+		for(int b = 0; b < 3; ++b)
+			same = same && p->blocks[b].first == r.blocks[b][0]
+			            && p->blocks[b].second == r.blocks[b][1];
+		if (same) {
+			p->orig_x = r.x;
+			p->orig_y = r.y;
+			return p;
+		}
+		p->rotate();
+	}
+
+	return nullptr;
+}
+
+// Full engine state in one fixed-layout record of 1088 bytes, native
+// byte order.  A snapshot file is an array of these, so it can be
+// mapped and used in place; readers check magic and version of every
+// record they use.  New fields go into the reserved bytes or come with
+// a new version.
+struct snapshot
+{
+	static constexpr std::uint32_t magic_value = 0x504e5354;  // "TSNP"
+	static constexpr std::uint32_t current_version = 1;
+	static constexpr std::size_t max_width = 32, max_height = 32;
+
+	std::uint32_t magic;
+	std::uint32_t version;
+	std::uint8_t width, height, game_over, reserved0;
+	std::int32_t score;
+	std::int32_t drop_height;
+	std::uint32_t seed;
+	std::uint32_t piece_state;
+
+	// time since the last gravity tick, for resuming mid-tick
+	std::uint32_t timer_phase_ms;
+
+	std::uint64_t engine_version;
+	piece_record active, next;
+	std::uint8_t reserved1[6];
+
+	std::uint8_t cells[max_height][max_width];
+};
+
+static_assert(std::is_trivially_copyable<snapshot>::value, "snapshot is copied as bytes");
+static_assert(sizeof(snapshot) == 1088, "snapshot layout changed, bump its version");
+
+inline snapshot take_snapshot(engine const& eng, std::uint32_t timer_phase_ms = 0)
+{
+	snapshot s{};
+
+	s.magic = snapshot::magic_value;
+	s.version = snapshot::current_version;
+	s.width = eng.width;
+	s.height = eng.height;
+	s.game_over = eng.game_over;
+	s.score = eng.score;
+	s.drop_height = eng.drop_height;
+	s.seed = eng.seed;
+	s.piece_state = eng.piece_state;
+	s.timer_phase_ms = timer_phase_ms;
+	s.engine_version = eng.version;
+	s.active = save_piece(eng.active_piece.get());
+	s.next = save_piece(eng.next_piece.get());
+
+	for(std::size_t y = 0; y < eng.height && y < snapshot::max_height; ++y)
+		for(std::size_t x = 0; x < eng.width && x < snapshot::max_width; ++x)
+			s.cells[y][x] = eng.board[y][x];
+
+	return s;
+}
+
+// The active piece of s, which the engine keeps on the board, lies on
+// the board in cells of its id
+inline bool active_on_board(snapshot const& s, piece const& p)
+{
+	auto on = [&](int x, int y) {
+		return x >= 0 && x < s.width && y >= 0 && y < s.height
+		    && s.cells[y][x] == p.id;
+	};
+
+	if (!on(p.orig_x, p.orig_y))
+		return false;
+	for(auto b : p.blocks)
+		if (!on(p.orig_x + b.first, p.orig_y + b.second))
+			return false;
+	return true;
+}
+
+inline bool valid(snapshot const& s)
+{
+	if (s.magic != snapshot::magic_value
+	    || s.version != snapshot::current_version
+	    || s.width == 0 || s.width > snapshot::max_width
+	    || s.height == 0 || s.height > snapshot::max_height
+	    || !load_piece(s.next))
+		return false;
+
+	if (!s.active.id)
+		return true;
+
+	auto active = load_piece(s.active);
+	return active && active_on_board(s, *active);
+}
+
+// Put a snapshot into eng, resizing its board; false if the record is
+// not a valid snapshot of this version, or its pieces are not ones the
+// engine could have left
+inline bool restore(snapshot const& s, engine& eng)
+{
+	if (!valid(s))
+		return false;
+
+	eng.width = s.width;
+	eng.height = s.height;
+	eng.board.assign(eng.height, std::vector<int>(eng.width, 0));
+
+	for(std::size_t y = 0; y < eng.height; ++y)
+		for(std::size_t x = 0; x < eng.width; ++x)
+			eng.board[y][x] = s.cells[y][x];
+
+	eng.game_over = s.game_over;
+	eng.score = s.score;
+	eng.drop_height = s.drop_height;
+	eng.seed = s.seed;
+	eng.piece_state = s.piece_state;
+	eng.version = s.engine_version + 1;
+	eng.dirty_rows = ~0ull;
+	eng.active_piece = load_piece(s.active);
+	eng.next_piece = load_piece(s.next);
+
+	return true;
+}
+
+// Write n snapshots to path, through a temporary file that is synced
+// and then renamed over it, so a crash never leaves a half written
+// checkpoint.
+inline bool write_snapshots(std::string const& path, snapshot const *s, std::size_t n)
+{
+	std::string tmp = path + ".tmp";
+
+	int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return false;
+
+	auto const *data = reinterpret_cast<const char *>(s);
+	std::size_t left = n * sizeof(snapshot);
+	while(left > 0) {
+		auto w = ::write(fd, data, left);
+		if (w < 0 && errno == EINTR)
+			continue;
+		if (w <= 0) {
+			::close(fd);
+			return false;
+		}
+		data += w;
+		left -= w;
+	}
+
+	bool synced = ::fsync(fd) == 0;
+	if (::close(fd) != 0 || !synced)
+		return false;
+
+	if (std::rename(tmp.c_str(), path.c_str()) != 0)
+		return false;
+
+	// and the rename itself, in the directory
+	auto slash = path.rfind('/');
+	auto dir = slash == std::string::npos ? std::string(".") : path.substr(0, slash + 1);
+	int dfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd >= 0) {
+		::fsync(dfd);
+		::close(dfd);
+	}
+
+	return true;
+}
+
+// Snapshot file mapped read-only.  The records are used in place; the
+// mapping lives as long as the object.
+class snapshot_file
+{
+public:
+	explicit snapshot_file(std::string const& path)
+		: file(path)
+	{}
+
+	// false if the file is missing, empty or not a whole number of
+	// records
+	bool ok() const
+	{
+		return file.size() > 0 && file.size() % sizeof(snapshot) == 0;
+	}
+
+	std::size_t size() const
+	{
+		return ok() ? file.size() / sizeof(snapshot) : 0;
+	}
+
+	snapshot const& operator[](std::size_t i) const
+	{
+		return reinterpret_cast<snapshot const *>(file.data())[i];
+	}
+
+private:
+	mapped_file file;
+};
+
+// Fixture boards are plain text, one line per row: '.' for an empty
+// cell, any other character is stored as it is.  Blank lines and lines
+// starting with '#' are skipped.  Returns false if there are no rows,
+// they differ in length or there are more than a snapshot holds.
+inline bool read_board(std::istream& in, engine& eng)
+{
+	std::vector<std::vector<int>> board;
+	std::string line;
+
+	while(std::getline(in, line)) {
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::vector<int> row;
+		for(char c : line)
+			row.push_back(c == '.' ? 0 : c);
+
+		if (!board.empty() && row.size() != board[0].size())
+			return false;
+		if (row.size() > snapshot::max_width || board.size() == snapshot::max_height)
+			return false;
+
+		board.push_back(std::move(row));
+	}
+
+	if (board.empty())
+		return false;
+
+	eng.width = board[0].size();
+	eng.height = board.size();
+	eng.board = std::move(board);
+	eng.dirty_rows = ~0ull;
+	++eng.version;
+
+	return true;
+}
+
+// A bare name like "tc1" is looked up among the fixtures FIXTURE_DIR
+// points at (set by the build); anything with a '/' or '.' is a path.
+inline std::string board_path(std::string const& name)
+{
+#ifdef FIXTURE_DIR
+	if (name.find_first_of("/.") == std::string::npos)
+		return std::string(FIXTURE_DIR) + "/" + name + ".board";
+#endif
+	return name;
+}
+
+inline bool is_snapshot_path(std::string const& path)
+{
+	auto dot = path.rfind('.');
+	return dot != std::string::npos && path.compare(dot, std::string::npos, ".snap") == 0;
+}
+
+// Load a board fixture or a snapshot (by its .snap suffix) into eng
+inline bool load_board_file(std::string const& name, engine& eng)
+{
+	auto path = board_path(name);
+
+	if (is_snapshot_path(path)) {
+		snapshot_file file(path);
+		return file.ok() && restore(file[0], eng);
+	}
+
+	std::ifstream in(path);
+	return in && read_board(in, eng);
+}
+
+}
+
+#endif // SNAPSHOT_H
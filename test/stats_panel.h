@@ -0,0 +1,215 @@
+#ifndef STATS_PANEL_H
+#define STATS_PANEL_H
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include <final/final.h>
+
+#include "partial_redraw.h"
+#include "proc_stats.h"
+
+// CPU, resident memory, context switches and I/O of a process, one row
+// each: the latest value and a sparkline of the ones before it.  The
+// sparkline sweeps like a scope trace instead of scrolling, the newest
+// value written over the oldest with a gap after it, so a tick repaints
+// the values and two cells a row.  A row is drawn again whole only when
+// its scale changes: at once when a value outgrows it, and when the
+// sweep starts over if everything has become much smaller.
+class StatsPanel : public finalcut::FWidget
+{
+public:
+	explicit StatsPanel(finalcut::FWidget *parent, std::size_t history = 512)
+		: finalcut::FWidget(parent)
+	{
+		metrics.push_back({"cpu", procstats::series(history), 100, 100});
+		metrics.push_back({"rss", procstats::series(history), 1 << 20, 1 << 20});
+		metrics.push_back({"ctx", procstats::series(history), 10, 10});
+		metrics.push_back({"io", procstats::series(history), 1 << 10, 1 << 10});
+	}
+
+	// Sample pid, 0 for this process, every interval_ms; false if it
+	// cannot be read
+	bool watch(pid_t pid, int interval_ms = 1000)
+	{
+		source = std::make_unique<procstats::sampler>(pid);
+		last = source->take();
+
+		for(auto& m : metrics) {
+			m.values = procstats::series(m.values.capacity());
+			m.scale = m.floor;
+		}
+
+		if (timer)
+			delTimer(timer);
+		interval = interval_ms;
+		timer = addTimer(interval);
+
+		redraw();
+		return source->ok();
+	}
+
+	int intervalMs() const
+	{
+		return interval;
+	}
+
+	void onTimer(finalcut::FTimerEvent *ev) override
+	{
+		if (ev->getTimerId() != timer)
+			return;
+		tick();
+	}
+
+	// Take a sample and draw it
+	void tick()
+	{
+		if (!source)
+			return;
+
+		auto now = source->take();
+		auto r = source->between(last, now);
+		last = now;
+
+		float v[] = {float(r.cpu_percent), float(r.rss_bytes),
+		             float(r.switches), float(r.io_bytes)};
+		for(std::size_t i = 0; i < metrics.size(); ++i)
+			add(metrics[i], v[i]);
+		has_io = r.has_io;
+
+		drawn.repaint();
+	}
+
+	void draw() override
+	{
+		auto cols = sparkWidth();
+		auto rows = std::min<std::size_t>(metrics.size(), getHeight());
+		drawn.begin(rows, cols);
+
+		setColor();
+
+		for(std::size_t r = 0; r < rows; ++r) {
+			auto& m = metrics[r];
+			int y = int(r) + 1;
+
+			print() << finalcut::FPoint(1, y) << label(r);
+			if (cols == 0)
+				continue;
+
+			auto n = m.values.count();
+			if (drawn.update(r, m.scale_version)) {
+				for(std::size_t c = 0; c < cols; ++c)
+					print() << finalcut::FPoint(int(value_width + c) + 1, y) << cell(m, c, cols);
+			} else if (n > 0) {
+				auto c = (n - 1) % cols;
+				print() << finalcut::FPoint(int(value_width + c) + 1, y) << cell(m, c, cols);
+				c = (c + 1) % cols;
+				print() << finalcut::FPoint(int(value_width + c) + 1, y) << cell(m, c, cols);
+			}
+		}
+	}
+
+private:
+	struct metric
+	{
+		char const *name;
+		procstats::series values;
+		float scale;
+		float floor;
+		std::uint64_t scale_version{0};
+	};
+
+	// "name  value " before the sparkline
+	static constexpr std::size_t value_width = 14;
+
+	std::vector<metric> metrics;
+	std::unique_ptr<procstats::sampler> source;
+	procstats::sample last;
+	bool has_io{false};
+
+	int timer{0};
+	int interval{1000};
+
+	// each sparkline, keyed by its scale_version
+	partial_redraw drawn{*this};
+
+	std::size_t sparkWidth() const
+	{
+		auto w = getWidth() > value_width ? getWidth() - value_width : 0;
+		return std::min<std::size_t>(w, metrics.front().values.capacity());
+	}
+
+	void add(metric& m, float v)
+	{
+		m.values.add(v);
+		auto cols = sparkWidth();
+
+		if (v > m.scale) {
+			// a little headroom, so a rising value does not rescale
+			// on every tick
+			m.scale = v * 1.25f;
+			++m.scale_version;
+		} else if (cols && m.values.count() % cols == 1) {
+			auto top = std::max(m.values.max_from(m.values.count() - std::min<std::uint64_t>(cols, m.values.count())), m.floor);
+			if (top * 4 < m.scale) {
+				m.scale = top * 1.25f;
+				++m.scale_version;
+			}
+		}
+	}
+
+	// The sparkline cell of column c: the newest value that fell there,
+	// blank for the gap after the newest and where there is none yet
+	finalcut::FString cell(metric const& m, std::size_t c, std::size_t cols) const
+	{
+		auto n = m.values.count();
+		if (n == 0)
+			return finalcut::FString(1, L' ');
+
+		auto newest = n - 1;
+		auto back = (newest % cols + cols - c) % cols;
+		if (back == cols - 1 && n >= cols)
+			return finalcut::FString(1, L' ');
+		if (back > newest || !m.values.has(newest - back))
+			return finalcut::FString(1, L' ');
+
+		auto level = int(m.values.at(newest - back) / m.scale * 8);
+		return finalcut::FString(1, wchar_t(0x2581 + std::max(0, std::min(level, 7))));
+	}
+
+	finalcut::FString label(std::size_t r) const
+	{
+		auto const& m = metrics[r];
+		char text[32];
+		float v = m.values.count() ? m.values.at(m.values.count() - 1) : 0;
+
+		switch(r) {
+		case 0:
+			std::snprintf(text, sizeof(text), "%-4s %7.1f%% ", m.name, v);
+			break;
+		case 2:
+			std::snprintf(text, sizeof(text), "%-4s %6.0f/s ", m.name, v);
+			break;
+		default:
+			if (r == 3 && !has_io) {
+				std::snprintf(text, sizeof(text), "%-4s %8s ", m.name, "n/a");
+				break;
+			}
+			char const *unit = " KMGT";
+			int u = 0;
+			for(; v >= 1024 && u < 4; ++u)
+				v /= 1024;
+			std::snprintf(text, sizeof(text), "%-4s %6.1f%c%s ", m.name, v, unit[u],
+			              r == 3 ? "/s" : "B");
+		}
+
+		// as wide as value_width whatever the value
+		finalcut::FString s{text};
+		if (s.getLength() < value_width)
+			s << finalcut::FString(value_width - s.getLength(), L' ');
+		return s.getLength() > value_width ? s.left(value_width) : s;
+	}
+};
+
+#endif // STATS_PANEL_H
@@ -3,766 +3,476 @@
 #include <memory>
 #include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 
 #include <final/final.h>
 
-namespace fc = finalcut;
+#include "alloc_stats.h"
+#include "asciicast.h"
+#include "board_painter.h"
+#include "dataset.h"
+#include "draw_stats.h"
+#include "effects.h"
+#include "history.h"
+#include "idle_timer.h"
+#include "replay_archive.h"
+#include "search.h"
+#include "snapshot.h"
+#include "tetris_engine.h"
 
-namespace game {
-struct color
-{
-	int r{255};
-	int g{255};
-	int b{255};
-	int a{255};
-};
+namespace fc = finalcut;
 
-struct piece
+class TetrisWindow : public fc::FWindow
 {
-	int id;
-	int orig_x, orig_y;
-	std::vector<std::pair<int, int>> blocks;
-	color c;
-
-	virtual ~piece() {}
-	virtual void rotate()
-	{}
-};
+public:
+	int startx{1}, starty{1};
 
-struct t_piece : piece
-{
-	t_piece()
-	{
-		id = 't';
+	// gravity interval at level 0, shorter with every level (see
+	// gravityInterval())
+	int update_ms = 300;
 
-		//     B       A                  C
-		//   A O C  => O B  => C O A => B O
-		//             C         B        A
+	// one timer ticks every effect and the timing wheel with gravity,
+	// lock delay and auto shift on it (see effects.h); a frame is drawn
+	// only when one of them set dirty.  Hidden or behind another window
+	// the game goes on at background_ms a tick, not drawn while hidden.
+	static constexpr int frame_ms = 16;
+	static constexpr int background_ms = 100;
+	idle_timer frames{*this, frame_ms, background_ms, background_ms};
+	bool dirty = false;
+	bool hidden = false;
+
+	// gravity rows come due on the wheel, as many at once as fell since
+	// the last frame; play() lets the piece fall them
+	effects::clock::time_point gravity_due{effects::clock::now()};
+	long gravity_rows = 0;
+	bool soft_drop = false;
+	bool hard_drop = false;
+
+	// a resting piece locks lock_ms later; moving or turning it starts
+	// the delay over, up to max_lock_resets times a piece
+	static constexpr int lock_ms = 500;
+	static constexpr int max_lock_resets = 15;
+	int lock_resets = 0;
+	bool lock_due = false;
+
+	// auto shift: while the terminal keeps repeating left or right
+	// (faster than max_repeat_gap), the piece shifts every shift_ms
+	static constexpr auto max_repeat_gap = std::chrono::milliseconds(100);
+	static constexpr auto shift_ms = std::chrono::milliseconds(20);
+	game::move shift_dir{game::move::left};
+	effects::clock::time_point shift_last{};
 
-		// xoff, yoff
-		blocks.push_back({-1,  0});
-		blocks.push_back({ 0, -1});
-		blocks.push_back({ 1,  0});
+	game::engine engine{15, 19};
 
-		// color
-		c = {128,0,128,255};
-	}
+	// state at every spawn, 'u' goes back one piece
+	game::board_history history{engine};
 
-	void rotate() override
-	{
-		for(auto& b : blocks) {
-			auto tmp = b.second;
-			b.second = b.first;
-			b.first = -tmp;
-		}
-	}
-};
+	BoardPainter painter{*this};
+	std::size_t win_width = 32, win_height = 21;
 
-struct s_piece : piece
-{
-	s_piece()
-	{
-		id = 's';
-
-		//    A B  =>  C
-		//  C O        O A
-		//               B
-		blocks.push_back({ 0, -1});
-		blocks.push_back({ 1, -1});
-		blocks.push_back({-1,  0});
-	}
+	bool basic_colors = false;
+
+	// 'p' lets the lookahead bot play, searching within botBudget()
+	game::searcher bot;
+	bool autoplay = false;
+	bool bot_placed = false;
+	game::searcher::result bot_result{};
+
+	// inputs since the board was loaded, stored in the archive when the
+	// game ends if one was given
+	game::replay_recorder recording;
+	std::unique_ptr<game::archive_writer> archive;
+
+	// every input as a training sample, with --export
+	std::unique_ptr<game::dataset_writer> dataset;
+
+	// while rows are cleared, the board before the clear is shown with
+	// those rows flashing, and keys wait
+	bool flashing = false;
+	game::cleared_rows cleared_lines;
+	decltype(game::engine::board) flash_board;
+
+	int lines = 0, level = 0;
+	int spawn_flashes = 0;
+	bool level_banner = false;
+	bool game_over_banner = false;
+
+	// what the last frame allocated: everything since the frame before,
+	// keys, the bot, engine updates and effects as well as the painting,
+	// and the frames where that was more than alloc_budget times (-1 for
+	// no budget).  The first frame in a painter mode may size its
+	// buffers and is not counted.
+	alloc_stats::counters frame_start{alloc_stats::this_thread()};
+	alloc_stats::counters frame_allocs{};
+	alloc_stats::counters engine_allocs{};
+	long alloc_budget = -1;
+	long frames_over_budget = 0;
+	long painted_frames = 0;
+	bool painted_half_block = false;
+
+	// last, so running effects go before what they use
+	effects::scheduler fx;
+
+	// on fx's wheel, so after it
+	effects::timing_wheel::timer gravity, lock, shift_repeat, shift_release;
 
-	void rotate() override
+public:
+	explicit TetrisWindow(fc::FWidget& parent)
+		: fc::FWindow(&parent)
 	{
-		for(auto& b : blocks) {
-			auto tmp = b.second;
-			b.second = b.first;
-			b.first = -tmp;
-		}
-	}
-};
+		resizeWindow();
 
-struct z_piece : piece
-{
-	z_piece()
-	{
-		id = 'z';
-
-		//  A B           A
-		//    O C   =>  O B
-		//              C
-		blocks.push_back({-1, -1});
-		blocks.push_back({ 0, -1});
-		blocks.push_back({ 1,  0});
-	}
+		engine.reset();
 
-	void rotate() override
-	{
-		for(auto& b : blocks) {
-			auto tmp = b.second;
-			b.second = b.first;
-			b.first = -tmp;
-		}
-	}
-};
+		gravity.action = [this] {
+			auto step = gravityInterval();
+			auto rows = 1 + (fx.now() - gravity_due) / step;
+			gravity_due += rows * step;
+			gravity_rows += rows;
+			fx.wheel().schedule(gravity, gravity_due);
+		};
 
-struct l_piece : piece
-{
-	std::vector<std::pair<int, int>> rots = {
-		//
-		{ 0,  1},
-		{ 1,  0},
-		{ 2,  0},
-		//
-		{ 0,  1},
-		{ 1,  1},
-		{ 0, -1},
-		//
-		{ 0, -1},
-		{-1,  0},
-		{-2,  0},
-		//
-		{ 0,  1},
-		{ 0, -1},
-		{-1, -1}
-	};
-	int rot_cur = 0;
-
-
-	l_piece()
-	{
-		id = 'l';
-
-		// O B C        C           A      C B
-		// A       =>   O   =>  C B O  =>    O
-		//              A B                  A
-		blocks.push_back(rots[0]);
-		blocks.push_back(rots[1]);
-		blocks.push_back(rots[2]);
-	}
+		lock.action = [this] { lock_due = true; };
 
-	void rotate() override
-	{
-		rot_cur += 3;
-		if ( rot_cur >= rots.size() )
-			rot_cur = 0;
-
-		blocks[0] = rots[rot_cur];
-		blocks[1] = rots[rot_cur+1];
-		blocks[2] = rots[rot_cur+2];
-	}
-};
+		shift_repeat.action = [this] {
+			if (!flashing) {
+				input(shift_dir);
+				dirty = true;
+			}
+			fx.wheel().schedule(shift_repeat, fx.now() + shift_ms);
+		};
 
-struct j_piece : piece
-{
-	std::vector<std::pair<int, int>> rots = {
-		//
-		{ 0,  1},
-		{-1,  0},
-		{-2,  0},
-		//
-		{ 1,  0},
-		{ 0,  1},
-		{ 0,  2},
-		//
-		{ 0,  1},
-		{ 1,  1},
-		{ 2,  1},
-		//
-		{ 0, -1},
-		{ 0,  1},
-		{-1,  1}
-	};
-	int rot_cur = 0;
-
-	j_piece()
-	{
-		id = 'j';
-
-		// C B O      O A                 A
-		//     A   => B     => O     =>   O
-		//            C        A B C    C B
-		blocks.push_back(rots[0]);
-		blocks.push_back(rots[1]);
-		blocks.push_back(rots[2]);
-	}
+		shift_release.action = [this] { shift_repeat.cancel(); };
 
-	void rotate() override
-	{
-		rot_cur += 3;
-		if ( rot_cur >= rots.size() )
-			rot_cur = 0;
+		restartGravity(effects::clock::now());
 
-		blocks[0] = rots[rot_cur];
-		blocks[1] = rots[rot_cur+1];
-		blocks[2] = rots[rot_cur+2];
+		frames.start();
+		fx.start(play());
 	}
-};
 
-struct o_piece : piece
-{
-	o_piece()
+	void onKeyPress (fc::FKeyEvent* ev) override
 	{
-		id = 'o';
-
-		// C A
-		// B O
-		//
-		blocks.push_back({ 0, -1});
-		blocks.push_back({-1,  0});
-		blocks.push_back({-1, -1});
-	}
-};
+		frames.busy();
 
-struct i_piece : piece
-{
-	i_piece()
-	{
-		id = 'i';
-
-		//               O
-		// O A B C  =>   A
-		//               B
-		//               C
-		blocks.push_back({ 1,  0});
-		blocks.push_back({ 2,  0});
-		blocks.push_back({ 3,  0});
-	}
+		if (flashing)
+			return;
 
-	void rotate() override
-	{
-		for(auto& b : blocks) {
-			int tmp = b.first;
-			b.first = b.second;
-			b.second = tmp;
-		}
-	}
-};
+		auto key = ev->key();
+		switch(key) {
+		case fc::fc::Fkey_escape:
+		case 'q':
+			close();
+			break;
 
+		case fc::fc::Fkey_left:
+		case 'a':
+			shift(game::move::left);
+			break;
 
-struct engine
-{
-	std::size_t width{8}, height{10};
-	std::vector<std::vector<int>> board;
-	std::unique_ptr<piece> active_piece{};
-	std::unique_ptr<piece> next_piece{generate_piece()};
+		case fc::fc::Fkey_right:
+		case 'd':
+			shift(game::move::right);
+			break;
 
-	int score{0};
-	int drop_height{0};
+		case fc::fc::Fkey_up:
+		case 'r':
+			input(game::move::rotate);
+			break;
 
-	explicit engine(std::size_t w = 8, std::size_t h = 10)
-		: width(w)
-		, height(h)
-	{}
+		case 'g':
+			painter.draw_ghost = !painter.draw_ghost;
+			break;
 
-	void reset()
-	{
-		// board[y][x]
-		board.resize( height, std::vector<int>(width, 0) );
-	}
+		// both lock at once when resting, without lock delay, and start
+		// the gravity interval over
+		case fc::fc::Fkey_down:
+			soft_drop = true;
+			break;
 
-	std::vector<std::size_t> update()
-	{
-		if (!active_piece) {
-			active_piece = std::move(next_piece);
-			active_piece->orig_x = width / 2;
-			active_piece->orig_y = 2;
+		case fc::fc::Fkey_space:
+			hard_drop = true;
+			break;
 
-			next_piece = generate_piece();
+		case 'x':
+			painter.scale_x = std::max(painter.scale_x-1, (std::size_t)1);
+			resizeWindow();
+			break;
+		case 'X':
+			painter.scale_x = painter.scale_x + 1;
+			resizeWindow();
+			break;
 
-			if (check_collision())
-				abort();
+		case 'y':
+			painter.scale_y = std::max(painter.scale_y-1, (std::size_t)1);
+			resizeWindow();
+			break;
+		case 'Y':
+			painter.scale_y = painter.scale_y + 1;
+			resizeWindow();
+			break;
 
-			cement_piece();
+		case 'h':
+			painter.half_block = !painter.half_block;
+			resizeWindow();
+			break;
 
-			return {};
-		}
+		case 's':
+			saveGame("tetris.snap");
+			break;
 
-		clear_active_piece();
+		case 'u':
+			history.rewind();
+			bot_placed = false;
+			lock.cancel();
+			lock_resets = 0;
 
-		active_piece->orig_y++;
+			// the replay cannot go backwards, record anew from here
+			recording.start(engine);
+			break;
 
-		if (check_collision()) {
-			active_piece->orig_y--;
+		case 'p':
+			autoplay = !autoplay;
+			bot_placed = false;
+			break;
 
-			cement_piece();
-			active_piece.reset();
+		case 'c':
+			basic_colors = !basic_colors;
+			painter.palette = basic_colors ? TetrisPalette::basic()
+			                               : TetrisPalette::classic();
+			break;
 
-			return try_clear_lines();
-		} else {
-			cement_piece();
+		default:
+			fc::FWindow::onKeyPress(ev);
 		}
 
-		return {};
-	}
-
-	void move_left()
-	{
-		if (!active_piece)
-			return;
-
-		if (active_piece->orig_x == 0)
-			return;
-
-		for(auto b : active_piece->blocks)
-			if (active_piece->orig_x + b.first <= 0)
-				return;
-
-		clear_active_piece();
-
-		active_piece->orig_x--;
-		if (check_collision())
-			active_piece->orig_x++;
-
-		cement_piece();
+		// drawn with the next frame, once for all keys that came in it
+		dirty = true;
 	}
 
-	void move_right()
+	void resizeWindow()
 	{
-		if (!active_piece)
-			return;
-
-		if (active_piece->orig_x == width - 1)
-			return;
-
-		for(auto b : active_piece->blocks)
-			if (active_piece->orig_x + b.first >= width - 1)
-				return;
-
-		clear_active_piece();
+		getRootWidget()->clearArea( );
 
-		active_piece->orig_x++;
-		if (check_collision())
-			active_piece->orig_x--;
+		std::size_t height = win_height*painter.scale_y;
+		if (painter.half_block)
+			height = painter.rows(engine.height) + 2;
 
-		cement_piece();
+		setGeometry({3, 3, painter.columns(win_width), height});
 	}
 
-	void rotate()
+	// Start from a board fixture or resume a .snap snapshot
+	bool loadBoard(std::string const& name)
 	{
-		if (!active_piece)
-			return;
-
-		clear_active_piece();
-
-		active_piece->rotate();
-
-		int offsets[] = {
-			-1, -2, +1, +2
-		};
-		int orig = active_piece->orig_x;
-		int i = 0;
-
-		while (check_collision() && i < sizeof(offsets)/sizeof(offsets[0])) {
-			active_piece->rotate();
-			active_piece->rotate();
-			active_piece->rotate();
+		std::uint32_t phase = 0;
+		auto path = game::board_path(name);
 
-			active_piece->orig_x = orig + offsets[i++];
-			active_piece->rotate();
+		if (game::is_snapshot_path(path)) {
+			game::snapshot_file file(path);
+			if (!file.ok() || !game::restore(file[0], engine))
+				return false;
+			phase = file[0].timer_phase_ms;
+		} else if (!game::load_board_file(path, engine)) {
+			return false;
 		}
 
-		if (check_collision()) {
-			active_piece->orig_x = orig;
+		history.clear();
+		recording.start(engine);
 
-			active_piece->rotate();
-			active_piece->rotate();
-			active_piece->rotate();
-		}
+		// first row after the rest of the interrupted interval
+		auto step = gravityInterval();
+		restartGravity(effects::clock::now()
+		               - std::min<effects::clock::duration>(std::chrono::milliseconds(phase), step));
 
-		cement_piece();
+		return true;
 	}
 
-	void clear_active_piece()
+	bool saveGame(std::string const& path)
 	{
-		auto x = active_piece->orig_x;
-		auto y = active_piece->orig_y;
+		// time since the last gravity row
+		auto step = gravityInterval();
+		auto left = gravity_due - effects::clock::now();
+		auto phase = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::clamp<effects::clock::duration>(step - left, {}, step));
+		auto snap = game::take_snapshot(engine, phase.count());
 
-		board[y][x] = 0;
-
-		for(auto b : active_piece->blocks)
-			board[y+b.second][x+b.first] = 0;
+		return game::write_snapshots(path, &snap, 1);
 	}
 
-	bool check_collision() const
+	// Time a row takes to fall at the current level: update_ms at level
+	// 0, then shorter along the usual guideline curve, below a frame
+	// from level 10 and a few rows a frame from level 15 on
+	std::chrono::microseconds gravityInterval() const
 	{
-		auto y = active_piece->orig_y;
-		auto x = active_piece->orig_x;
-
-		if (y == height || board[y][x] != 0)
-			return true;
-
-		for(auto b : active_piece->blocks)
-			if (y + b.second <= 0
-			    || y + b.second >= height
-			    || x + b.first < 0
-			    || x + b.first >= width
-			    || (board[y + b.second][x + b.first] != 0
-			        && board[y + b.second][x + b.first] != 'g'))
-				return true;
-
-		return false;
+		double f = std::pow(0.8 - level * 0.007, level);
+		return std::chrono::microseconds(std::max(long(update_ms * 1000 * f), 50l));
 	}
 
-	void cement_piece()
+	// Next gravity row one interval after from
+	void restartGravity(effects::clock::time_point from)
 	{
-		auto x = active_piece->orig_x;
-		auto y = active_piece->orig_y;
-
-		if (y < height && y >= 0)
-			board[y][x] = active_piece->id;
-
-		for(auto b : active_piece->blocks)
-			if (y < height && y >= 0 && x >= 0 && x < width)
-				board[y+b.second][x+b.first] = active_piece->id;
+		gravity_rows = 0;
+		gravity_due = from + gravityInterval();
+		fx.wheel().schedule(gravity, gravity_due);
 	}
 
-	std::vector<std::size_t> try_clear_lines()
+	// Left and right.  Terminals send no key releases, only the key
+	// again at their repeat rate once it is held, so that is how holding
+	// is told from tapping: once the repeats come, which is after the
+	// terminal's own delay, the piece shifts on the wheel every
+	// shift_ms, until they stop.
+	void shift(game::move m)
 	{
-		std::vector<std::size_t> linenumstoclear;
-
-		for (int y = height-1; y != 0; --y) {
-			bool isfull = true;
-
-			for (int x = 0; x < width; ++x)
-				if (board[y][x] == 0) {
-					isfull = false;
-					break;
-				}
-
-			if (isfull)
-				linenumstoclear.push_back(y);
-		}
+		auto now = effects::clock::now();
+		auto gap = now - shift_last;
+		bool repeat = m == shift_dir && gap < max_repeat_gap;
 
-		if (linenumstoclear.empty())
-			return linenumstoclear;
+		shift_last = now;
+		shift_dir = m;
 
-		auto remaining = linenumstoclear;
-
-		int cleared = 0;
-		for (int beg = -1, cur = 0;
-		     !remaining.empty() && cleared < 4;
-		     ++beg,++cur,++cleared)
-		{
-			board.erase(board.begin() + remaining[0],
-			            board.begin() + remaining[0] + 1);
-
-			remaining.erase(remaining.begin());
+		if (!repeat) {
+			shift_repeat.cancel();
+			shift_release.cancel();
+			input(m);
+			return;
 		}
 
-		std::reverse(board.begin(), board.end());
-		while(board.size() != height)
-			board.push_back( std::vector<int>(width, 0) );
-		std::reverse(board.begin(), board.end());
-
-		switch(cleared) {
-		case 1:
-			score += 40;
-			break;
-		case 2:
-			score += 100;
-			break;
-		case 3:
-			score += 300;
-			break;
-		case 4:
-		default:
-			score += 1200;
-			break;
+		if (!shift_repeat.pending()) {
+			input(m);
+			fx.wheel().schedule(shift_repeat, now + shift_ms);
 		}
 
-		return linenumstoclear;
+		// held while the next repeat comes about as soon as this one did
+		auto hold = std::clamp<effects::clock::duration>(gap * 3 / 2,
+		                                                  std::chrono::milliseconds(30),
+		                                                  max_repeat_gap);
+		fx.wheel().schedule(shift_release, now + hold);
 	}
 
-	std::unique_ptr<piece> generate_piece() const {
-		static int next_id = 1;
-
-		switch(next_id++ % 7) {
-		case 0:
-			return std::make_unique<t_piece>();
-
-		case 1:
-			return std::make_unique<s_piece>();
-
-		case 2:
-			return std::make_unique<z_piece>();
-
-		case 3:
-			return std::make_unique<o_piece>();
-
-		case 4:
-			return std::make_unique<l_piece>();
-
-		case 5:
-			return std::make_unique<j_piece>();
+	// Start the lock delay over after a move of a resting piece, or
+	// stop it if the piece can fall again
+	void resetLock()
+	{
+		if (!lock.pending())
+			return;
 
-		case 6:
-		default:
-			return std::make_unique<i_piece>();
-		}
+		if (!engine.resting())
+			lock.cancel();
+		else if (lock_resets++ < max_lock_resets)
+			fx.wheel().schedule(lock, fx.now() + std::chrono::milliseconds(lock_ms));
 	}
 
-	std::unique_ptr<piece> ghost_piece() {
-		if (!active_piece)
-			return nullptr;
-
-		auto gp = std::make_unique<piece>();
-		gp->blocks = active_piece->blocks;
-		gp->id = active_piece->id;
-		gp->c = active_piece->c;
-		gp->orig_x = active_piece->orig_x;
-		gp->orig_y = active_piece->orig_y;
-
-		clear_active_piece();
+	// Let the piece fall the rows due, spawning one first if needed;
+	// a piece that comes to rest waits for the lock delay
+	void fall(long rows)
+	{
+		for(; rows > 0 && !engine.game_over; --rows) {
+			if (engine.active_piece && engine.resting()) {
+				if (!lock.pending())
+					fx.wheel().schedule(lock, fx.now() + std::chrono::milliseconds(lock_ms));
+				break;
+			}
 
-		while( !check_collision() ) {
-			active_piece->orig_y++;
+			doUpdate();
 		}
-
-		active_piece->orig_y--;
-		int tmp = active_piece->orig_y;
-
-		active_piece->orig_y = gp->orig_y;
-		gp->orig_y = tmp;
-
-		cement_piece();
-
-		return gp;
 	}
 
-	std::ostream& print(std::ostream& os) const
+	bool openArchive(std::string const& dir)
 	{
-		for(int y = 0; y < board.size(); ++y) {
-
-			for(int x = 0; x < board[0].size(); ++x)
-				if (board[y][x] == 0)
-					std::cout << "0" << " ";
-				else os << (char)board[y][x] << " ";
-
-			os << "\n";
-		}
-
-		return os;
+		archive = std::make_unique<game::archive_writer>(dir);
+		return archive->ok();
 	}
 
-	friend std::ostream& operator<<(std::ostream& os, engine const& eng) {
-		return eng.print(os);
+	bool openDataset(std::string const& path)
+	{
+		dataset = std::make_unique<game::dataset_writer>(path, engine.width, engine.height);
+		return dataset->ok();
 	}
-};
-
-}
-
-class TetrisWindow : public fc::FWindow
-{
-public:
-	int startx{1}, starty{1};
-	int update_ms = 300;
-	int timer_id{0};
 
-	game::engine engine{15, 19};
-
-	std::size_t scale_x = 4, scale_y = 2;
-	std::size_t win_width = 32, win_height = 21;
-
-	bool draw_ghost = true;
-
-	bool animating = false;
-	std::chrono::high_resolution_clock::time_point animating_start{};
-	std::size_t animating_frame = 0;
-	std::vector<std::size_t> cleared_lines;
-	decltype(game::engine::board) animating_board;
-
-
-public:
-	explicit TetrisWindow(fc::FWidget& parent)
-		: fc::FWindow(&parent)
+	// Store the game played so far and the samples, once
+	void finishGame()
 	{
-		resizeWindow();
-
-		engine.reset();
+		if (archive && recording.recording())
+			archive->append(recording, engine);
+		recording.stop();
 
-		timer_id = addTimer(update_ms);
+		if (dataset)
+			dataset->close();
 	}
 
-	void onKeyPress (fc::FKeyEvent* ev) override
+	// Run an input, as a training sample when exporting
+	template <typename F>
+	void sample(game::action a, F&& apply)
 	{
-		if (animating)
-			return;
-
-		auto key = ev->key();
-		switch(key) {
-		case fc::fc::Fkey_escape:
-		case 'q':
-			close();
-			break;
-
-		case fc::fc::Fkey_left:
-		case 'a':
-			engine.move_left();
-			break;
-
-		case fc::fc::Fkey_right:
-		case 'd':
-			engine.move_right();
-			break;
-
-		case fc::fc::Fkey_up:
-		case 'r':
-			engine.rotate();
-			break;
-
-		case 'g':
-			draw_ghost = !draw_ghost;
-			break;
-
-		case fc::fc::Fkey_down:
-			delTimer(timer_id);
-			if (!doUpdate())
-				timer_id = addTimer(update_ms);
-			break;
-
-		case fc::fc::Fkey_space:
-			while(engine.active_piece)
-				doUpdate();
-			break;
-
-		case 'x':
-			scale_x = std::max(scale_x-1, (std::size_t)1);
-			resizeWindow();
-			break;
-		case 'X':
-			scale_x = scale_x + 1;
-			resizeWindow();
-			break;
-
-		case 'y':
-			scale_y = std::max(scale_y-1, (std::size_t)1);
-			resizeWindow();
-			break;
-		case 'Y':
-			scale_y = scale_y + 1;
-			resizeWindow();
-			break;
+		if (dataset)
+			dataset->capture(engine, a, apply);
+		else
+			apply();
+	}
 
-		default:
-			fc::FWindow::onKeyPress(ev);
-		}
+	// One input from the keyboard or the bot
+	void input(game::move m)
+	{
+		recording.add(m);
+		sample(game::to_action(m), [&] { game::apply(engine, m); });
 
-		redraw();
+		if (m != game::move::down)
+			resetLock();
 	}
 
-	void resizeWindow()
+	// Terminal row of line n of the score panel; half-block boards do
+	// not scale rows, so neither does the panel
+	int textRow(int n) const
 	{
-		getRootWidget()->clearArea( );
-
-		setGeometry({3, 3, scale_x*win_width, win_height*scale_y});
+		if (painter.half_block)
+			return n;
+		return n * painter.scale_y;
 	}
 
-	fc::fc::colornames getPieceColor(char p) const
+	void doUpdate()
 	{
-		std::vector<fc::fc::colornames> animating_colors = {
-			fc::fc::Grey100,
-			fc::fc::Grey93,
-			fc::fc::Grey89,
-			fc::fc::Grey85,
-			fc::fc::Grey84,
-			// fc::fc::Grey82,
-			// fc::fc::Grey78,
-			// fc::fc::Grey74,
-			// fc::fc::Grey70
-		};
+		alloc_stats::scope allocs;
 
-		switch(p) {
-		case 't':
-			return fc::fc::Purple;
+		// copy-assigning reuses the rows already allocated for the
+		// previous tick
+		flash_board = engine.board;
 
-		case 's':
-			return fc::fc::Red;
-
-		case 'z':
-			return fc::fc::Blue;
-
-		case 'l':
-			return fc::fc::Orange1;
-
-		case 'j':
-			return fc::fc::DarkSeaGreen1;
-
-		case 'o':
-			return fc::fc::Yellow;
-
-		case 'i':
-			return fc::fc::Cyan;
-
-		case '9':
-			return fc::fc::DarkRed2;
-		case '8':
-			return fc::fc::DarkRed;
-		case '7':
-			return fc::fc::Red3;
-		case '6':
-			return fc::fc::Red2;
-		case '5':
-			return fc::fc::Red1;
-		case '4':
-			return fc::fc::Red;
-		case '3':
-			return fc::fc::MediumVioletRed;
-		case '2':
-			return fc::fc::LightRed;
-		case '1':
-			return fc::fc::PaleVioletRed1;
-		case '0':
-			return fc::fc::Black;
-
-		case 0:
-		default:
-			if (animating)
-				return animating_colors[ rand() % animating_colors.size() ];
-			return fc::fc::Black;
-		}
-	}
+		bool spawning = !engine.active_piece;
+		sample(game::action::none, [&] { cleared_lines = recording.update(engine); });
 
-	bool doUpdate()
-	{
-		animating_board = engine.board;
+		if (spawning && engine.active_piece) {
+			history.record();
+			fx.start(spawnFlash());
+		}
 
-		cleared_lines = engine.update();
-		if (cleared_lines.size() > 0)
-			startAnimation();
+		engine_allocs = allocs.delta();
 
-		return cleared_lines.size();
+		if (!engine.active_piece) {
+			bot_placed = false;
+			lock.cancel();
+			lock_due = false;
+			lock_resets = 0;
+		}
 	}
 
 	void draw() override
 	{
+		draw_stats::timer timing;
+
+		painter.palette.beginFrame(fx.frame());
+
 		// clearArea(getVirtualDesktop(), fc::fc::Red2);
 		setColor(fc::fc::LightBlue, fc::fc::Cyan);
 
 		clearArea( fc::fc::MediumShade );
 
 		print() << fc::FPoint(startx,starty) << "well well well "
-		        << animating_frame << fc::fc::FullBlock;
-
-		for(int y = 0; y != engine.board.size(); ++y) {
-			for(int x = 0; x < engine.board[y].size(); ++x) {
-				fc::fc::colornames color;
-				if (animating)
-					color = getPieceColor(animating_board[y][x]);
-				else
-					color = getPieceColor(engine.board[y][x]);
-				setColor(color, color);
-
-				for(int sy = 0; sy < scale_y; ++sy) {
-					for(int sx = 0; sx < scale_x; ++sx)
-						print() << fc::FPoint(x*scale_x + 1 + sx, y*scale_y + 1 + sy) << " ";
-				}
-
-			}
-		}
+		        << fx.frame() << fc::fc::FullBlock;
 
-		drawGhostPiece();
-		drawActivePiece();
+		painter.drawBoard(engine, flashing ? flash_board : engine.board,
+		                  flashing, 1, 1);
 
 		drawScore();
 
@@ -770,377 +480,326 @@ public:
 
 		setColor(fc::fc::White, fc::fc::Grey0);
 		drawBorder();
+
+		auto now = alloc_stats::this_thread();
+		frame_allocs = now - frame_start;
+		frame_start = now;
+		checkAllocBudget();
+	}
+
+	void checkAllocBudget()
+	{
+		bool steady = painted_frames++ > 0 && painter.half_block == painted_half_block;
+		painted_half_block = painter.half_block;
+
+		if (steady && alloc_budget >= 0 && frame_allocs.allocs > std::uint64_t(alloc_budget))
+			++frames_over_budget;
 	}
 
 	void drawScore()
 	{
 		setColor(fc::fc::White, fc::fc::Black);
 
-		for(int y = 1; y < 10; ++y) {
-			for(int x = 18; x < 32; ++x) {
-				for(int sy = 0; sy < scale_y; ++sy)
-					for(int sx = 0; sx < scale_x; ++sx)
-						print() << fc::FPoint(x*scale_x + sx, y*scale_y + sy) << " ";
+		auto cw = painter.cellWidth();
+
+		for(int y = textRow(1); y < textRow(10); ++y) {
+			for(int x = 18*cw; x < 32*cw; ++x) {
+				print() << fc::FPoint(x, y);
+				print(L' ');
 			}
 		}
 
-		print() << fc::FPoint(20*scale_x, 3*scale_y) << "Score: " << engine.score;
+		if (game_over_banner)
+			print() << fc::FPoint(20*cw, textRow(1)) << "Game over";
+		else if (level_banner)
+			print() << fc::FPoint(20*cw, textRow(1)) << "Level up!";
+
+		if (autoplay)
+			print() << fc::FPoint(20*cw, textRow(2))
+			        << "Bot: depth " << bot_result.depth << ", "
+			        << bot_result.nodes << " nodes";
+
+		print() << fc::FPoint(20*cw, textRow(3)) << "Score: " << engine.score
+		        << "  Level " << level;
+
+		if (alloc_stats::enabled) {
+			// figures are from the previous frame and engine update
+			print() << fc::FPoint(20*cw, textRow(4))
+			        << "Frame: " << frame_allocs.allocs << " allocs, "
+			        << frame_allocs.bytes << " B";
+			print() << fc::FPoint(20*cw, textRow(5))
+			        << "Engine: " << engine_allocs.allocs << " allocs, "
+			        << engine_allocs.bytes << " B";
+		}
 	}
 
 	void drawNextPiece()
 	{
 		int startx = 25;
 		int starty = 8;
-		auto color = getPieceColor(engine.next_piece->id);
 
-		setColor(fc::fc::White, fc::fc::Black);
-		print() << fc::FPoint(20*scale_x, 6*scale_y) << "Next: ";
-
-		setColor(color, color);
-		for(int sy = 0; sy < scale_y; ++sy)
-			for(int sx = 0; sx < scale_x; ++sx)
-				print() << fc::FPoint(startx*scale_x + sx, starty*scale_y + sy) << " ";
-
-		for(auto b : engine.next_piece->blocks)
-			for(int sy = 0; sy < scale_y; ++sy)
-				for(int sx = 0; sx < scale_x; ++sx)
-					print() << fc::FPoint((startx+b.first)*scale_x + sx,
-					                      (starty+b.second)*scale_y + sy)
-					        << " ";
+		if (spawn_flashes)
+			setColor(fc::fc::Black, fc::fc::White);
+		else
+			setColor(fc::fc::White, fc::fc::Black);
+		print() << fc::FPoint(20*painter.cellWidth(), textRow(6)) << "Next: ";
+
+		painter.drawPreview(*engine.next_piece,
+		                    (startx - 2)*painter.cellWidth(), textRow(starty - 1));
 	}
 
-	void drawGhostPiece()
+	void onTimer(fc::FTimerEvent *ev) override
 	{
-		if (!draw_ghost)
+		if (!frames.is(ev))
 			return;
 
-		auto gp = engine.ghost_piece();
-		if (!gp)
-			return;
-
-		int x = gp->orig_x, y = gp->orig_y;
-
-		setColor(fc::fc::Grey30, fc::fc::Grey30);
+		fx.tick();
 
-		gp->blocks.push_back({0, 0});
-
-		for(auto b : gp->blocks) {
-			for(int sy = 0; sy < scale_y; ++sy)
-				for(int sx = 0; sx < scale_x; ++sx)
-					print() << fc::FPoint((x+b.first)*scale_x + 1 + sx, (y+b.second)*scale_y + 1 + sy) << " ";
+		// kept for when the window shows again
+		bool changed = dirty;
+		if (dirty && !hidden) {
+			dirty = false;
+			redraw();
 		}
+
+		frames.tick(changed);
 	}
 
-	void drawActivePiece()
+	void onShow(fc::FShowEvent *ev) override
 	{
-		auto& ap = engine.active_piece;
-		if (!ap)
-			return;
-
-		int x = ap->orig_x, y = ap->orig_y;
+		hidden = false;
+		frames.background(false);
+		fc::FWindow::onShow(ev);
+	}
 
-		auto color = getPieceColor(ap->id);
+	void onHide(fc::FHideEvent *ev) override
+	{
+		hidden = true;
+		frames.background(true);
+		fc::FWindow::onHide(ev);
+	}
 
-		setColor(color, color);
+	void onWindowActive(fc::FEvent *ev) override
+	{
+		frames.background(hidden);
+		fc::FWindow::onWindowActive(ev);
+	}
 
-		for(int sy = 0; sy < scale_y; ++sy)
-			for(int sx = 0; sx < scale_x; ++sx)
-				print() << fc::FPoint((x)*scale_x + 1 + sx, (y)*scale_y + 1 + sy) << " ";
+	void onWindowInactive(fc::FEvent *ev) override
+	{
+		frames.background(true);
+		fc::FWindow::onWindowInactive(ev);
+	}
 
-		for(auto b : ap->blocks) {
-			for(int sy = 0; sy < scale_y; ++sy)
-				for(int sx = 0; sx < scale_x; ++sx)
-					print() << fc::FPoint((x+b.first)*scale_x + 1 + sx, (y+b.second)*scale_y + 1 + sy) << " ";
-		}
+	// The bot searches on this thread, between two frames: for at most
+	// three quarters of one, so drawing and keys never wait a frame for
+	// it, and less at levels where a row falls faster than that
+	std::chrono::microseconds botBudget() const
+	{
+		auto frame = std::chrono::microseconds(frame_ms * 1000) * 3 / 4;
+		return std::min(frame, gravityInterval() / 2);
 	}
 
-	void onTimer(fc::FTimerEvent *) override
+	void botMove()
 	{
-		if (animating)
-			onAnimationTimer(nullptr);
-		else
-			onEngineTimer(nullptr);
+		bot.options.budget = botBudget();
+		bot_result = bot.search(engine);
+		if (bot_result.best) {
+			game::move moves[game::move_generator::max_states];
+			auto n = bot.path(*bot_result.best, moves, game::move_generator::max_states);
+			for(std::size_t i = 0; i < n; ++i)
+				input(moves[i]);
+		}
+		bot_placed = true;
 	}
 
-	void onEngineTimer(fc::FTimerEvent*)
+	// The game: gravity, a drop or the lock delay running out, then
+	// whatever it set off, in turn
+	effects::effect play()
 	{
-		startx++; if (startx >= getWidth()) { startx = 0; ++starty; }
-		starty++; if (starty >= getHeight()) { starty = 0; startx = 0; }
+		for(;;) {
+			co_await fx.until([this] {
+				return gravity_rows > 0 || soft_drop || hard_drop || lock_due;
+			});
 
-		doUpdate();
+			startx++; if (startx >= getWidth()) { startx = 0; ++starty; }
+			starty++; if (starty >= getHeight()) { starty = 0; startx = 0; }
 
-		redraw();
-	}
+			if (autoplay && engine.active_piece && !bot_placed)
+				botMove();
 
-	void startAnimation()
-	{
-		std::size_t animation_ms = 1;
+			if (hard_drop) {
+				while(engine.active_piece)
+					doUpdate();
+				restartGravity(fx.now());
+			} else if (soft_drop) {
+				doUpdate();
+				restartGravity(fx.now());
+			} else if (lock_due) {
+				doUpdate();
+			} else {
+				fall(gravity_rows);
+			}
+
+			gravity_rows = 0;
+			soft_drop = hard_drop = lock_due = false;
+			dirty = true;
+
+			if (!cleared_lines.empty()) {
+				int before = level;
+				lines += cleared_lines.size();
+				level = lines / 10;
 
-		animating = true;
-		animating_start = std::chrono::high_resolution_clock::now();
-		animating_frame = 0;
+				co_await lineClear();
 
-		delTimer(timer_id);
-		timer_id = addTimer(animation_ms);
+				// no rows piled up behind the flash
+				restartGravity(fx.now());
 
-		for (int y = 0; y < cleared_lines.size(); ++y) {
-			for(int x = 0; x < engine.width; ++x) {
-				animating_board[cleared_lines[y]][x] = '9';
+				if (level != before)
+					fx.start(levelUp());
+			}
+
+			if (engine.game_over) {
+				co_await gameOver();
+				co_return;
 			}
 		}
 	}
 
-	void onAnimationTimer(fc::FTimerEvent*)
+	// The cleared rows flash for a quarter second
+	effects::effect lineClear()
 	{
-		std::size_t animation_time_ms = 250;
+		for(auto y : cleared_lines)
+			std::fill(flash_board[y].begin(), flash_board[y].end(), '9');
+
+		flashing = true;
+		auto end = fx.now() + std::chrono::milliseconds(250);
 
-		++animating_frame;
+		while(fx.now() < end) {
+			co_await fx.next_frame();
 
-		auto dur = std::chrono::high_resolution_clock::now() - animating_start;
-		auto dur_ms = std::chrono::duration_cast<std::chrono::milliseconds>(dur);
-		if ( dur_ms.count() > animation_time_ms ) {
-			animating = false;
-			delTimer(timer_id);
-			timer_id = addTimer(update_ms);
-			cleared_lines.clear();
+			for(auto y : cleared_lines)
+				for(auto& cell : flash_board[y])
+					cell = cell == '9' ? '0' : '9';
+			dirty = true;
 		}
 
+		flashing = false;
+		cleared_lines.clear();
+	}
 
-		// X X X X X X
-		//     ^ ^
-		//     l r
-		// X X X X X X X
-		//     l 0 r
-		bool iseven = engine.width % 2 == 0;
-
-		for (int i = 0; i < animating_board.size(); ++i) {
-			if (!iseven && animating_board[i][engine.width / 2] == '9')
-				animating_board[i][engine.width / 2] = '0';
-			else if (!iseven && animating_board[i][engine.width / 2] == '0')
-				animating_board[i][engine.width / 2] = '9';
-
-			for (int left = engine.width / 2 - 1,
-				     right = iseven ? engine.width / 2 : engine.width / 2 + 1;
-			     left >= 0 && right < engine.width;
-			     --left,++right)
-			{
-				if (animating_board[i][left] == '9')
-					animating_board[i][left] = '0';
-				else if (animating_board[i][left] == '0')
-					animating_board[i][left] = '9';
-
-				if (animating_board[i][right] == '9')
-					animating_board[i][right] = '0';
-				else if (animating_board[i][right] == '0')
-					animating_board[i][right] = '9';
-			}
+	// "Next:" lights up for a few frames as a piece comes in
+	effects::effect spawnFlash()
+	{
+		++spawn_flashes;
+		co_await fx.frames(6);
+		--spawn_flashes;
+		dirty = true;
+	}
+
+	effects::effect levelUp()
+	{
+		for(int i = 0; i < 6; ++i) {
+			level_banner = i % 2 == 0;
+			dirty = true;
+			co_await fx.sleep(std::chrono::milliseconds(150));
+		}
+	}
+
+	// Store the game, blink the news for two seconds and quit
+	effects::effect gameOver()
+	{
+		finishGame();
+
+		for(int i = 0; i < 8; ++i) {
+			game_over_banner = i % 2 == 0;
+			dirty = true;
+			co_await fx.sleep(std::chrono::milliseconds(250));
 		}
 
-		redraw();
+		close();
 	}
 
 };
 
+// tetris [--board NAME|FILE] [--archive DIR] [--export FILE] [--record FILE]
+//        [--alloc-budget N]
+//
+// NAME is one of the boards in fixtures/, FILE a board file or a .snap
+// snapshot saved with 's' to resume.  With --archive the game is added
+// to the replay archive in DIR when it ends or the window is closed
+// (see replay_archive.h).  --export writes every input, the bot's too,
+// as a training sample to FILE (see dataset.h), --record the terminal
+// session in asciicast format (see asciicast.h).
+//
+// With --alloc-budget it exits with status 1 if any steady frame, with
+// everything the game did since the frame before, allocated more than
+// N times; finalcut's own allocations count too.  This needs a build
+// with TETRIS_ALLOC_STATS, and render_bench can drive it.
 int main(int argc, char **argv)
 {
-#if 1
+	std::string board = "well";
+	std::string archive;
+	std::string samples;
+	long alloc_budget = -1;
+
+	auto session = asciicast::from_args(argc, argv);
+	if (session && !session->ok()) {
+		std::cerr << "cannot record to " << session->path() << "\n";
+		return 2;
+	}
+
+	int out = 1;
+	for(int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--board") == 0 && i + 1 < argc)
+			board = argv[++i];
+		else if (std::strcmp(argv[i], "--archive") == 0 && i + 1 < argc)
+			archive = argv[++i];
+		else if (std::strcmp(argv[i], "--export") == 0 && i + 1 < argc)
+			samples = argv[++i];
+		else if (std::strcmp(argv[i], "--alloc-budget") == 0 && i + 1 < argc)
+			alloc_budget = std::max(0l, std::atol(argv[++i]));
+		else
+			argv[out++] = argv[i];
+	}
+	argc = out;
+
+	if (alloc_budget >= 0 && !alloc_stats::enabled) {
+		std::cerr << "--alloc-budget needs a build with TETRIS_ALLOC_STATS\n";
+		return 2;
+	}
+
 	fc::FApplication app{argc, argv};
 	TetrisWindow mainwindow{app};
+	mainwindow.alloc_budget = alloc_budget;
+
+	if (!mainwindow.loadBoard(board)) {
+		std::cerr << "cannot load board " << board << "\n";
+		return 2;
+	}
 
-	mainwindow.engine.board = {
-		{ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 },
-		{ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 },
-		{ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 },
-		{ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 },
-		{ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 },
-		{ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 },
-		{ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 },
-		{ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 },
-		{ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 },
-		{ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 },
-		{ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 },
-		{ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 },
-		{ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 },
-		{ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 },
-		{ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 },
-		{ 's','s','s','s','s','s','s', 0,'s','s','s','s','s','s','s' },
-		{ 's','s','s','s','s','s','s', 0,'s','s','s','s','s','s','s' },
-		{ 's','s','s','s','s','s','s', 0,'s','s','s','s','s','s','s' },
-		{ 's','s','s','s','s','s','s', 0,'s','s','s','s','s','s','s' },
-	};
+	if (!archive.empty() && !mainwindow.openArchive(archive)) {
+		std::cerr << "cannot open archive " << archive << "\n";
+		return 2;
+	}
+
+	if (!samples.empty() && !mainwindow.openDataset(samples)) {
+		std::cerr << "cannot write " << samples << "\n";
+		return 2;
+	}
 
 	app.setMainWidget(&mainwindow);
 
 	mainwindow.show();
 
-	return app.exec();
-#else
-	std::vector<std::vector<int>> tc1 = {
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{'9','9','9','9','9','9','9','9'},
-	};
-
-	std::vector<std::vector<int>> tc2 = {
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{'9','9','9','9','9','9','9','9'},
-		{'9','9','9','9','9','9','9','9'},
-	};
-
-	std::vector<std::vector<int>> tc3 = {
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{'9','9','9','9','9','9','9','9'},
-		{0,0,0,0,0,0,0,0},
-		{'9','9','9','9','9','9','9','9'},
-	};
-
-	std::vector<std::vector<int>> tc4 = {
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{'9','9','9', 0 , 0 ,'9','9','9'},
-		{'9','9','9','9','9','9','9','9'},
-		{'9','9','9','9','9','9','9','9'},
-		{'9','9','9','9','9','9','9','9'},
-	};
-
-	std::vector<std::vector<int>> tc5 = {
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{'9','9','9', 0 , 0 ,'9','9','9'},
-		{'9','9','9','9','9','9','9','9'},
-		{'9','9', 0 , 0 , 0 ,'9','9','9'},
-		{'9','9','9','9','9','9','9','9'},
-	};
-
-	std::vector<std::vector<int>> tc6 = {
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{0,0,0,0,0,0,0,0},
-		{'9','9','9','9', 0 ,'9','9','9'},
-		{'9','9','9', 0 , 0 ,'9','9','9'},
-		{'9','9','9','9', 0 ,'9','9','9'},
-		{'9','9', 0 , 0 , 0 ,'9','9','9'},
-		{'9','9','9', 0 ,'9','9','9','9'},
-	};
-
-	game::engine eng{8, 20};
-	eng.reset();
-
-	eng.board = tc6;
-
-	std::cout << eng << "\n";
-
-	std::string input;
-	while(std::getline(std::cin, input)) {
-		if (input == "a")
-			eng.move_left();
-		else if (input == "d")
-			eng.move_right();
-		else if (input == "r")
-			eng.rotate();
-
-		eng.update();
-		eng.print(std::cout);
-		std::cout << "\n\n";
+	int status = app.exec();
+	mainwindow.finishGame();
+
+	if (mainwindow.frames_over_budget) {
+		std::cerr << mainwindow.frames_over_budget << " frames painted with more than "
+		          << alloc_budget << " allocations\n";
+		return 1;
 	}
 
-	return 0;
-#endif
+	return status;
 }
@@ -0,0 +1,177 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "battle.h"
+#include "worker_pool.h"
+
+// Headless bot tournament of versus games (see battle.h).
+//
+//   tetris_battle [--matches N] [--players N] [--threads N] [--lockstep]
+//                 [--width N] [--height N] [--seed N] [--max-ticks N]
+//                 [--verify] [--json]
+//
+// Match k is played with seed --seed + k.  By default whole matches are
+// spread over the threads; --lockstep instead plays one match at a time
+// with its players on their own threads, meeting at every tick.
+// --verify plays every match again on one thread and fails if anything
+// came out differently, to check the lockstep result does not depend on
+// the threads.  Boards are at most 30 by 32, the most the bots' bitboards
+// hold.
+
+namespace {
+
+struct outcome
+{
+	int winner{-1};
+	long ticks{0};
+	std::vector<int> scores;
+	long garbage{0};
+
+	bool operator==(outcome const& o) const
+	{
+		return winner == o.winner && ticks == o.ticks && scores == o.scores
+		    && garbage == o.garbage;
+	}
+};
+
+outcome play(game::battle_options const& options, worker_pool *pool)
+{
+	game::battle b(options);
+	b.run(pool);
+
+	outcome r;
+	r.winner = b.winner();
+	r.ticks = b.ticks();
+	for(std::size_t i = 0; i < b.size(); ++i) {
+		r.scores.push_back(b[i].eng.score);
+		r.garbage += b[i].sent;
+	}
+
+	return r;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	long matches = 100;
+	std::size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+	bool lockstep = false;
+	bool verify = false;
+	bool json = false;
+	game::battle_options options;
+
+	for(int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool more = i + 1 < argc;
+
+		if (arg == "--matches" && more)
+			matches = std::atol(argv[++i]);
+		else if (arg == "--players" && more)
+			options.players = std::max(std::atoi(argv[++i]), 2);
+		else if (arg == "--threads" && more)
+			threads = std::max(std::atoi(argv[++i]), 1);
+		else if (arg == "--lockstep")
+			lockstep = true;
+		else if (arg == "--width" && more)
+			options.width = std::clamp(std::atoi(argv[++i]), 4, int(game::bitboard::max_width));
+		else if (arg == "--height" && more)
+			options.height = std::clamp(std::atoi(argv[++i]), 6, int(game::bitboard::max_height));
+		else if (arg == "--seed" && more)
+			options.seed = std::strtoul(argv[++i], nullptr, 10);
+		else if (arg == "--max-ticks" && more)
+			options.max_ticks = std::atol(argv[++i]);
+		else if (arg == "--verify")
+			verify = true;
+		else if (arg == "--json")
+			json = true;
+		else {
+			std::cerr << "usage: " << argv[0]
+			          << " [--matches N] [--players N] [--threads N] [--lockstep]"
+			          << " [--width N] [--height N] [--seed N] [--max-ticks N]"
+			          << " [--verify] [--json]\n";
+			return 2;
+		}
+	}
+
+	std::vector<outcome> results(matches);
+	worker_pool pool(threads);
+	auto seed = options.seed;
+
+	auto start = std::chrono::steady_clock::now();
+
+	if (lockstep) {
+		for(long k = 0; k < matches; ++k) {
+			options.seed = seed + k;
+			results[k] = play(options, &pool);
+		}
+	} else {
+		pool.run([&](std::size_t w) {
+			auto o = options;
+			for(long k = w; k < matches; k += pool.size()) {
+				o.seed = seed + k;
+				results[k] = play(o, nullptr);
+			}
+		});
+	}
+
+	std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+
+	long mismatches = 0;
+	if (verify)
+		for(long k = 0; k < matches; ++k) {
+			options.seed = seed + k;
+			mismatches += !(play(options, nullptr) == results[k]);
+		}
+
+	std::vector<long> wins(options.players);
+	long draws = 0, ticks = 0, garbage = 0;
+	for(auto const& r : results) {
+		if (r.winner < 0)
+			++draws;
+		else
+			++wins[r.winner];
+		ticks += r.ticks;
+		garbage += r.garbage;
+	}
+
+	double per_minute = matches / secs.count() * 60;
+	double mean_ticks = matches ? double(ticks) / matches : 0;
+
+	if (json) {
+		std::cout << "{\n  \"matches\": " << matches
+		          << ",\n  \"players\": " << options.players
+		          << ",\n  \"threads\": " << threads
+		          << ",\n  \"lockstep\": " << (lockstep ? "true" : "false")
+		          << ",\n  \"seconds\": " << secs.count()
+		          << ",\n  \"matches_per_minute\": " << per_minute
+		          << ",\n  \"mean_ticks\": " << mean_ticks
+		          << ",\n  \"garbage_rows\": " << garbage
+		          << ",\n  \"draws\": " << draws
+		          << ",\n  \"wins\": [";
+		for(std::size_t i = 0; i < wins.size(); ++i)
+			std::cout << (i ? ", " : "") << wins[i];
+		std::cout << "]";
+		if (verify)
+			std::cout << ",\n  \"mismatches\": " << mismatches;
+		std::cout << "\n}\n";
+	} else {
+		std::cout << matches << " matches of " << options.players << " players on "
+		          << threads << (lockstep ? " lockstep" : "") << " threads: "
+		          << per_minute << " matches/min, " << mean_ticks << " ticks each, "
+		          << garbage << " garbage rows\n"
+		          << "wins:";
+		for(auto w : wins)
+			std::cout << " " << w;
+		std::cout << ", draws " << draws << "\n";
+		if (verify)
+			std::cout << mismatches << " matches differ when replayed on one thread\n";
+	}
+
+	return mismatches ? 1 : 0;
+}
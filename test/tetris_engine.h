@@ -0,0 +1,1080 @@
+#ifndef TETRIS_ENGINE_H
+#define TETRIS_ENGINE_H
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+
+#include "placement.h"
+
+namespace game {
+struct color
+{
+	int r{255};
+	int g{255};
+	int b{255};
+	int a{255};
+};
+
+struct piece
+{
+	int id;
+	int orig_x, orig_y;
+	std::vector<std::pair<int, int>> blocks;
+	color c;
+
+	virtual ~piece() {}
+	virtual void rotate()
+	{}
+
+	virtual std::unique_ptr<piece> clone() const
+	{
+		return std::make_unique<piece>(*this);
+	}
+};
+
+struct t_piece : piece
+{
+	t_piece()
+	{
+		id = 't';
+
+		//     B       A                  C
+		//   A O C  => O B  => C O A => B O
+		//             C         B        A
+
+		// xoff, yoff
+		blocks.push_back({-1,  0});
+		blocks.push_back({ 0, -1});
+		blocks.push_back({ 1,  0});
+
+		// color
+		c = {128,0,128,255};
+	}
+
+	void rotate() override
+	{
+		for(auto& b : blocks) {
+			auto tmp = b.second;
+			b.second = b.first;
+			b.first = -tmp;
+		}
+	}
+
+	std::unique_ptr<piece> clone() const override
+	{
+		return std::make_unique<t_piece>(*this);
+	}
+};
+
+struct s_piece : piece
+{
+	s_piece()
+	{
+		id = 's';
+
+		//    A B  =>  C
+		//  C O        O A
+		//               B
+		blocks.push_back({ 0, -1});
+		blocks.push_back({ 1, -1});
+		blocks.push_back({-1,  0});
+	}
+
+	void rotate() override
+	{
+		for(auto& b : blocks) {
+			auto tmp = b.second;
+			b.second = b.first;
+			b.first = -tmp;
+		}
+	}
+
+	std::unique_ptr<piece> clone() const override
+	{
+		return std::make_unique<s_piece>(*this);
+	}
+};
+
+struct z_piece : piece
+{
+	z_piece()
+	{
+		id = 'z';
+
+		//  A B           A
+		//    O C   =>  O B
+		//              C
+		blocks.push_back({-1, -1});
+		blocks.push_back({ 0, -1});
+		blocks.push_back({ 1,  0});
+	}
+
+	void rotate() override
+	{
+		for(auto& b : blocks) {
+			auto tmp = b.second;
+			b.second = b.first;
+			b.first = -tmp;
+		}
+	}
+
+	std::unique_ptr<piece> clone() const override
+	{
+		return std::make_unique<z_piece>(*this);
+	}
+};
+
+struct l_piece : piece
+{
+	std::vector<std::pair<int, int>> rots = {
+		//
+		{ 0,  1},
+		{ 1,  0},
+		{ 2,  0},
+		//
+		{ 0,  1},
+		{ 1,  1},
+		{ 0, -1},
+		//
+		{ 0, -1},
+		{-1,  0},
+		{-2,  0},
+		//
+		{ 0,  1},
+		{ 0, -1},
+		{-1, -1}
+	};
+	int rot_cur = 0;
+
+
+	l_piece()
+	{
+		id = 'l';
+
+		// O B C        C           A      C B
+		// A       =>   O   =>  C B O  =>    O
+		//              A B                  A
+		blocks.push_back(rots[0]);
+		blocks.push_back(rots[1]);
+		blocks.push_back(rots[2]);
+	}
+
+	void rotate() override
+	{
+		rot_cur += 3;
+		if ( rot_cur >= (int)rots.size() )
+			rot_cur = 0;
+
+		blocks[0] = rots[rot_cur];
+		blocks[1] = rots[rot_cur+1];
+		blocks[2] = rots[rot_cur+2];
+	}
+
+	std::unique_ptr<piece> clone() const override
+	{
+		return std::make_unique<l_piece>(*this);
+	}
+};
+
+struct j_piece : piece
+{
+	std::vector<std::pair<int, int>> rots = {
+		//
+		{ 0,  1},
+		{-1,  0},
+		{-2,  0},
+		//
+		{ 1,  0},
+		{ 0,  1},
+		{ 0,  2},
+		//
+		{ 0,  1},
+		{ 1,  1},
+		{ 2,  1},
+		//
+		{ 0, -1},
+		{ 0,  1},
+		{-1,  1}
+	};
+	int rot_cur = 0;
+
+	j_piece()
+	{
+		id = 'j';
+
+		// C B O      O A                 A
+		//     A   => B     => O     =>   O
+		//            C        A B C    C B
+		blocks.push_back(rots[0]);
+		blocks.push_back(rots[1]);
+		blocks.push_back(rots[2]);
+	}
+
+	void rotate() override
+	{
+		rot_cur += 3;
+		if ( rot_cur >= (int)rots.size() )
+			rot_cur = 0;
+
+		blocks[0] = rots[rot_cur];
+		blocks[1] = rots[rot_cur+1];
+		blocks[2] = rots[rot_cur+2];
+	}
+
+	std::unique_ptr<piece> clone() const override
+	{
+		return std::make_unique<j_piece>(*this);
+	}
+};
+
+struct o_piece : piece
+{
+	o_piece()
+	{
+		id = 'o';
+
+		// C A
+		// B O
+		//
+		blocks.push_back({ 0, -1});
+		blocks.push_back({-1,  0});
+		blocks.push_back({-1, -1});
+	}
+
+	std::unique_ptr<piece> clone() const override
+	{
+		return std::make_unique<o_piece>(*this);
+	}
+};
+
+struct i_piece : piece
+{
+	i_piece()
+	{
+		id = 'i';
+
+		//               O
+		// O A B C  =>   A
+		//               B
+		//               C
+		blocks.push_back({ 1,  0});
+		blocks.push_back({ 2,  0});
+		blocks.push_back({ 3,  0});
+	}
+
+	void rotate() override
+	{
+		for(auto& b : blocks) {
+			int tmp = b.first;
+			b.first = b.second;
+			b.second = tmp;
+		}
+	}
+
+	std::unique_ptr<piece> clone() const override
+	{
+		return std::make_unique<i_piece>(*this);
+	}
+};
+
+
+// One player input followed by a gravity tick, see engine::step()
+// Rows one lock cleared, bottom-most first.  The engine clears at most
+// four at once, so they fit a fixed buffer and clearing lines does not
+// allocate.
+struct cleared_rows
+{
+	static constexpr std::size_t capacity = 4;
+
+	std::size_t rows[capacity]{};
+	std::size_t count{0};
+
+	std::size_t size() const
+	{
+		return count;
+	}
+
+	bool empty() const
+	{
+		return count == 0;
+	}
+
+	std::size_t front() const
+	{
+		return rows[0];
+	}
+
+	std::size_t operator[](std::size_t i) const
+	{
+		return rows[i];
+	}
+
+	std::size_t const *begin() const
+	{
+		return rows;
+	}
+
+	std::size_t const *end() const
+	{
+		return rows + count;
+	}
+
+	void clear()
+	{
+		count = 0;
+	}
+};
+
+enum class action : std::uint8_t
+{
+	none,
+	left,
+	right,
+	rotate,
+	drop
+};
+
+struct engine
+{
+	std::size_t width{8}, height{10};
+
+	// Piece sequence: seed 0 cycles through the seven pieces in a fixed
+	// order, any other seed draws them from a xorshift generator.
+	std::uint32_t seed{0};
+	std::uint32_t piece_state{1};
+
+	std::vector<std::vector<int>> board;
+
+	// Pieces the engine is done with, up to two of each kind, which
+	// new_piece() hands out again instead of allocating
+	std::unique_ptr<piece> spares[7][2];
+
+	std::unique_ptr<piece> active_piece{};
+	std::unique_ptr<piece> next_piece{generate_piece()};
+
+	int score{0};
+	int drop_height{0};
+
+	// Set instead of spawning when a new piece has no room; update()
+	// does nothing until restart().
+	bool game_over{false};
+
+	// Bumped on every change to the board, for views that only repaint
+	// what changed.
+	std::uint64_t version{0};
+
+	// Bit y is set when row y changed since a board_history last looked
+	// (see history.h).  Code writing to board directly should set it too.
+	// One bit per row is why a board has at most max_height rows.
+	std::uint64_t dirty_rows{~0ull};
+
+	// The board as row masks for check_collision() and ghost_y(), see
+	// placement.h.  Kept up to date by the engine's own moves and built
+	// again once version shows someone else wrote to the board.
+	mutable bitboard filled;
+	mutable std::uint64_t filled_version{~0ull};
+
+	// Rows the last update() cleared
+	cleared_rows cleared;
+
+	// Rows a board can have, one bit of dirty_rows each; the constructor
+	// cuts taller boards down to it
+	static constexpr std::size_t max_height = 64;
+
+	// Cell value of rows pushed in by add_garbage()
+	static constexpr int garbage_cell = 'x';
+
+	explicit engine(std::size_t w = 8, std::size_t h = 10, std::uint32_t s = 0)
+		: width(w)
+		, height(std::min(h, max_height))
+		, seed(s)
+		, piece_state(s ? s : 1)
+	{}
+
+	engine(engine const& o)
+		: width(o.width)
+		, height(o.height)
+		, seed(o.seed)
+		, piece_state(o.piece_state)
+		, board(o.board)
+		, active_piece(o.active_piece ? o.active_piece->clone() : nullptr)
+		, next_piece(o.next_piece->clone())
+		, score(o.score)
+		, drop_height(o.drop_height)
+		, game_over(o.game_over)
+		, version(o.version)
+		, dirty_rows(o.dirty_rows)
+		, filled(o.filled)
+		, filled_version(o.filled_version)
+		, cleared(o.cleared)
+	{}
+
+	engine& operator=(engine const& o)
+	{
+		width = o.width;
+		height = o.height;
+		seed = o.seed;
+		piece_state = o.piece_state;
+		board = o.board;
+		recycle(std::move(active_piece));
+		recycle(std::move(next_piece));
+		active_piece = copy_piece(o.active_piece.get());
+		next_piece = copy_piece(o.next_piece.get());
+		score = o.score;
+		drop_height = o.drop_height;
+		game_over = o.game_over;
+		version = o.version;
+		dirty_rows = o.dirty_rows;
+		filled = o.filled;
+		filled_version = o.filled_version;
+		cleared = o.cleared;
+
+		return *this;
+	}
+
+	engine(engine&&) = default;
+	engine& operator=(engine&&) = default;
+
+	void reset()
+	{
+		// board[y][x]
+		board.resize( height, std::vector<int>(width, 0) );
+	}
+
+	// Empty board and score, continuing the piece sequence
+	void restart()
+	{
+		reset();
+
+		for(auto& row : board)
+			std::fill(row.begin(), row.end(), 0);
+
+		recycle(std::move(active_piece));
+		score = 0;
+		game_over = false;
+		++version;
+		dirty_rows = ~0ull;
+	}
+
+	// Let gravity tick once; returns the rows it cleared, which stay in
+	// cleared until the next update()
+	cleared_rows const& update()
+	{
+		cleared.clear();
+
+		if (game_over)
+			return cleared;
+
+		if (!active_piece) {
+			active_piece = std::move(next_piece);
+			active_piece->orig_x = width / 2;
+			active_piece->orig_y = 2;
+
+			next_piece = generate_piece();
+
+			if (check_collision()) {
+				recycle(std::move(active_piece));
+				game_over = true;
+				return cleared;
+			}
+
+			cement_piece();
+
+			return cleared;
+		}
+
+		clear_active_piece();
+
+		active_piece->orig_y++;
+
+		if (check_collision()) {
+			active_piece->orig_y--;
+
+			cement_piece();
+			recycle(std::move(active_piece));
+
+			return try_clear_lines();
+		} else {
+			cement_piece();
+		}
+
+		return cleared;
+	}
+
+	// Apply one input and let gravity tick once, like a player pressing
+	// a key between two timer ticks.  drop lets the piece fall until it
+	// locks.  Returns the cleared lines like update().
+	cleared_rows const& step(action a)
+	{
+		switch(a) {
+		case action::left:
+			move_left();
+			break;
+
+		case action::right:
+			move_right();
+			break;
+
+		case action::rotate:
+			rotate();
+			break;
+
+		case action::drop:
+			while(active_piece) {
+				update();
+				if (!active_piece)
+					return cleared;
+			}
+			break;
+
+		case action::none:
+			break;
+		}
+
+		return update();
+	}
+
+	// Push n rows in from the bottom, full but for column hole, as an
+	// opponent's attack.  The stack moves up; a filled cell pushed off the
+	// top ends the game.  The active piece stays where it is unless the
+	// stack now overlaps it, then it moves up just enough, and the game
+	// ends if there is no room for it.
+	void add_garbage(std::size_t n, std::size_t hole)
+	{
+		if (game_over || n == 0)
+			return;
+
+		n = std::min(n, height);
+
+		if (active_piece)
+			clear_active_piece();
+
+		bool overflow = false;
+		for(std::size_t y = 0; y < n; ++y)
+			for(auto cell : board[y])
+				overflow = overflow || cell != 0;
+
+		// the top rows become the new bottom ones, reusing their storage
+		std::rotate(board.begin(), board.begin() + n, board.end());
+		for(std::size_t y = height - n; y < height; ++y) {
+			std::fill(board[y].begin(), board[y].end(), garbage_cell);
+			board[y][hole % width] = 0;
+		}
+
+		dirty_rows = ~0ull;
+		++version;
+
+		if (active_piece) {
+			while(check_collision() && active_piece->orig_y > 1)
+				active_piece->orig_y--;
+
+			if (check_collision()) {
+				recycle(std::move(active_piece));
+				overflow = true;
+			} else {
+				cement_piece();
+			}
+		}
+
+		game_over = game_over || overflow;
+	}
+
+	void move_left()
+	{
+		if (!active_piece)
+			return;
+
+		if (active_piece->orig_x == 0)
+			return;
+
+		for(auto b : active_piece->blocks)
+			if (active_piece->orig_x + b.first <= 0)
+				return;
+
+		clear_active_piece();
+
+		active_piece->orig_x--;
+		if (check_collision())
+			active_piece->orig_x++;
+
+		cement_piece();
+	}
+
+	void move_right()
+	{
+		if (!active_piece)
+			return;
+
+		if (active_piece->orig_x == (int)width - 1)
+			return;
+
+		for(auto b : active_piece->blocks)
+			if (active_piece->orig_x + b.first >= (int)width - 1)
+				return;
+
+		clear_active_piece();
+
+		active_piece->orig_x++;
+		if (check_collision())
+			active_piece->orig_x--;
+
+		cement_piece();
+	}
+
+	void rotate()
+	{
+		if (!active_piece)
+			return;
+
+		clear_active_piece();
+
+		active_piece->rotate();
+
+		int offsets[] = {
+			-1, -2, +1, +2
+		};
+		int orig = active_piece->orig_x;
+		int i = 0;
+
+		while (check_collision() && i < (int)(sizeof(offsets)/sizeof(offsets[0]))) {
+			active_piece->rotate();
+			active_piece->rotate();
+			active_piece->rotate();
+
+			active_piece->orig_x = orig + offsets[i++];
+			active_piece->rotate();
+		}
+
+		if (check_collision()) {
+			active_piece->orig_x = orig;
+
+			active_piece->rotate();
+			active_piece->rotate();
+			active_piece->rotate();
+		}
+
+		cement_piece();
+	}
+
+	void clear_active_piece()
+	{
+		auto x = active_piece->orig_x;
+		auto y = active_piece->orig_y;
+		bool masks = bitboard::fits(width, height);
+
+		board[y][x] = 0;
+		dirty_rows |= 1ull << y;
+		if (masks)
+			filled.rows[y] &= ~(1u << x);
+
+		for(auto b : active_piece->blocks) {
+			board[y+b.second][x+b.first] = 0;
+			dirty_rows |= 1ull << (y + b.second);
+			if (masks)
+				filled.rows[y + b.second] &= ~(1u << (x + b.first));
+		}
+	}
+
+	bool check_collision() const
+	{
+		if (auto p = active_placement())
+			return placement_masks_for(width).collides(filled_rows(), *p,
+			                                           active_piece->orig_y);
+
+		return check_collision_cells();
+	}
+
+	// check_collision() cell by cell, for pieces without masks
+	bool check_collision_cells() const
+	{
+		auto y = active_piece->orig_y;
+		auto x = active_piece->orig_x;
+
+		// a wall kick can move the origin itself off the board
+		if (y == (int)height || x < 0 || x >= (int)width || board[y][x] != 0)
+			return true;
+
+		for(auto b : active_piece->blocks)
+			if (y + b.second <= 0
+			    || y + b.second >= (int)height
+			    || x + b.first < 0
+			    || x + b.first >= (int)width
+			    || (board[y + b.second][x + b.first] != 0
+			        && board[y + b.second][x + b.first] != 'g'))
+				return true;
+
+		return false;
+	}
+
+	void cement_piece()
+	{
+		auto x = active_piece->orig_x;
+		auto y = active_piece->orig_y;
+		bool masks = bitboard::fits(width, height);
+		bool synced = filled_version == version;
+
+		if (y >= 0 && y < (int)height) {
+			board[y][x] = active_piece->id;
+			dirty_rows |= 1ull << y;
+			if (masks)
+				filled.rows[y] |= 1u << x;
+		}
+
+		for(auto b : active_piece->blocks)
+			if (y >= 0 && y < (int)height && x >= 0 && x < (int)width) {
+				board[y+b.second][x+b.first] = active_piece->id;
+				dirty_rows |= 1ull << (y + b.second);
+				if (masks)
+					filled.rows[y + b.second] |= 1u << (x + b.first);
+			}
+
+		++version;
+		if (synced)
+			filled_version = version;
+	}
+
+	// filled as the board is now
+	bitboard const& filled_rows() const
+	{
+		if (filled_version == version)
+			return filled;
+
+		filled = bitboard{};
+		filled.width = width;
+		filled.height = height;
+
+		for(std::size_t y = 0; y < height; ++y)
+			for(std::size_t x = 0; x < width; ++x)
+				if (board[y][x] != 0)
+					filled.rows[y] |= 1u << x;
+
+		filled_version = version;
+		return filled;
+	}
+
+	// Masks of the active piece where it is now, or null for a piece no
+	// table has or a board larger than a bitboard
+	placement const *active_placement() const
+	{
+		if (!bitboard::fits(width, height))
+			return nullptr;
+
+		auto kind = kind_of(active_piece->id);
+		int r = rotation_of(kind, active_piece->blocks);
+		if (r < 0)
+			return nullptr;
+
+		return &placement_masks_for(width)(kind, r, active_piece->orig_x);
+	}
+
+	cleared_rows const& try_clear_lines()
+	{
+		cleared.clear();
+
+		for (int y = height-1; y != 0 && cleared.count < cleared_rows::capacity; --y) {
+			bool isfull = true;
+
+			for (int x = 0; x < (int)width; ++x)
+				if (board[y][x] == 0) {
+					isfull = false;
+					break;
+				}
+
+			if (isfull)
+				cleared.rows[cleared.count++] = y;
+		}
+
+		if (cleared.empty())
+			return cleared;
+
+		// Rotate each full row to the top and blank it instead of
+		// erasing it and pushing a fresh row, so clearing lines reuses
+		// the existing row storage.  Rows go top-most first so the
+		// indices of the rows still to be cleared stay valid.
+		for (int i = cleared.size() - 1; i >= 0; --i) {
+			auto row = board.begin() + cleared[i];
+
+			std::rotate(board.begin(), row, row + 1);
+			std::fill(board.front().begin(), board.front().end(), 0);
+		}
+
+		// every row above the lowest cleared one moved
+		dirty_rows |= ~0ull >> (63 - cleared.front());
+		++version;
+
+		switch(cleared.size()) {
+		case 1:
+			score += 40;
+			break;
+		case 2:
+			score += 100;
+			break;
+		case 3:
+			score += 300;
+			break;
+		case 4:
+		default:
+			score += 1200;
+			break;
+		}
+
+		return cleared;
+	}
+
+	std::unique_ptr<piece> generate_piece() {
+		return new_piece(draw_kind(piece_state));
+	}
+
+	// A piece of a kind turned r times from how it spawns, one of the
+	// spares if there is one
+	std::unique_ptr<piece> new_piece(std::uint32_t kind, int r = 0)
+	{
+		// as make_piece(), anything past the i piece is one
+		kind = std::min<std::uint32_t>(kind, 6);
+
+		std::unique_ptr<piece> p;
+		for(auto& spare : spares[kind])
+			if (spare) {
+				p = std::move(spare);
+				break;
+			}
+
+		if (!p)
+			return turned(make_piece(kind), kind, r);
+		return turned(std::move(p), kind, r);
+	}
+
+	// Keep a piece the engine is done with for new_piece(); pieces it
+	// did not make and those beyond two of a kind are freed
+	void recycle(std::unique_ptr<piece> p)
+	{
+		if (!p)
+			return;
+
+		auto kind = kind_of(p->id);
+		if (p->id != id_of(kind) || rotation_of(kind, p->blocks) < 0)
+			return;
+
+		for(auto& spare : spares[kind])
+			if (!spare) {
+				spare = std::move(p);
+				return;
+			}
+	}
+
+	// A copy of p, from the spares if the engine could have made it
+	std::unique_ptr<piece> copy_piece(piece const *p)
+	{
+		if (!p)
+			return nullptr;
+
+		auto kind = kind_of(p->id);
+		int r = rotation_of(kind, p->blocks);
+		if (p->id != id_of(kind) || r < 0)
+			return p->clone();
+
+		auto q = new_piece(kind, r);
+		q->orig_x = p->orig_x;
+		q->orig_y = p->orig_y;
+		return q;
+	}
+
+	// Kind of a coming piece without drawing it, see make_piece();
+	// peek_kind(0) is the one after next_piece
+	std::uint32_t peek_kind(std::size_t n) const
+	{
+		std::uint32_t state = piece_state;
+		std::uint32_t kind = draw_kind(state);
+
+		for(std::size_t i = 0; i < n; ++i)
+			kind = draw_kind(state);
+
+		return kind;
+	}
+
+	// Advance the piece sequence state and return the kind drawn, 0..6
+	std::uint32_t draw_kind(std::uint32_t& state) const
+	{
+		std::uint32_t next_id = state;
+
+		if (seed == 0) {
+			++state;
+		} else {
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			next_id = state;
+		}
+
+		return next_id % 7;
+	}
+
+	// Kind of a piece id, the inverse of make_piece()
+	static std::uint32_t kind_of(int id)
+	{
+		switch(id) {
+		case 't':
+			return 0;
+
+		case 's':
+			return 1;
+
+		case 'z':
+			return 2;
+
+		case 'o':
+			return 3;
+
+		case 'l':
+			return 4;
+
+		case 'j':
+			return 5;
+
+		case 'i':
+		default:
+			return 6;
+		}
+	}
+
+	// Piece id of a kind, the inverse of kind_of()
+	static int id_of(std::uint32_t kind)
+	{
+		return "tszolji"[std::min<std::uint32_t>(kind, 6)];
+	}
+
+	static std::unique_ptr<piece> make_piece(std::uint32_t kind)
+	{
+		switch(kind) {
+		case 0:
+			return std::make_unique<t_piece>();
+
+		case 1:
+			return std::make_unique<s_piece>();
+
+		case 2:
+			return std::make_unique<z_piece>();
+
+		case 3:
+			return std::make_unique<o_piece>();
+
+		case 4:
+			return std::make_unique<l_piece>();
+
+		case 5:
+			return std::make_unique<j_piece>();
+
+		case 6:
+		default:
+			return std::make_unique<i_piece>();
+		}
+	}
+
+	// p, of the given kind, turned until it is in rotation r
+	static std::unique_ptr<piece> turned(std::unique_ptr<piece> p, std::uint32_t kind, int r)
+	{
+		for(int turn = 0; turn < 4 && rotation_of(kind, p->blocks) != r; ++turn)
+			p->rotate();
+		return p;
+	}
+
+	// Whether the active piece sits on the stack or the floor, so that
+	// the next update() locks it.  The board is not touched.
+	bool resting() const
+	{
+		if (!active_piece)
+			return false;
+
+		int x = active_piece->orig_x;
+		int y = active_piece->orig_y;
+
+		auto own = [&](int cx, int cy) {
+			if (cx == x && cy == y)
+				return true;
+			for(auto b : active_piece->blocks)
+				if (cx == x + b.first && cy == y + b.second)
+					return true;
+			return false;
+		};
+
+		auto blocked = [&](int cx, int cy) {
+			return cy + 1 >= (int)height
+			    || (board[cy + 1][cx] != 0 && board[cy + 1][cx] != 'g'
+			        && !own(cx, cy + 1));
+		};
+
+		if (blocked(x, y))
+			return true;
+		for(auto b : active_piece->blocks)
+			if (blocked(x + b.first, y + b.second))
+				return true;
+
+		return false;
+	}
+
+	// Row the active piece would come to rest on if dropped straight
+	// down, or -1 without an active piece.  The piece itself is left
+	// where it is.
+	int ghost_y()
+	{
+		if (!active_piece)
+			return -1;
+
+		if (auto p = active_placement()) {
+			// the board without the piece
+			auto b = filled_rows();
+			for(int i = 0; i < p->rows; ++i)
+				b.rows[active_piece->orig_y + p->top + i] &= ~p->mask[i];
+
+			return placement_masks_for(width).drop(b, *p, active_piece->orig_y);
+		}
+
+		int orig_y = active_piece->orig_y;
+
+		clear_active_piece();
+
+		while( !check_collision() ) {
+			active_piece->orig_y++;
+		}
+
+		int landing_y = active_piece->orig_y - 1;
+		active_piece->orig_y = orig_y;
+
+		cement_piece();
+
+		return landing_y;
+	}
+
+	std::ostream& print(std::ostream& os) const
+	{
+		for(std::size_t y = 0; y < board.size(); ++y) {
+
+			for(std::size_t x = 0; x < board[0].size(); ++x)
+				if (board[y][x] == 0)
+					os << "0" << " ";
+				else os << (char)board[y][x] << " ";
+
+			os << "\n";
+		}
+
+		return os;
+	}
+
+	friend std::ostream& operator<<(std::ostream& os, engine const& eng) {
+		return eng.print(os);
+	}
+};
+
+// Rotation of a piece the engine made as in piece_shapes, or -1 for one
+// it did not
+inline int rotation_of(piece const& p)
+{
+	return rotation_of(engine::kind_of(p.id), p.blocks);
+}
+
+}
+
+#endif // TETRIS_ENGINE_H
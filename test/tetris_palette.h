@@ -0,0 +1,148 @@
+#ifndef TETRIS_PALETTE_H
+#define TETRIS_PALETTE_H
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+
+#include <final/final.h>
+
+#include "tetris_engine.h"
+
+namespace fc = finalcut;
+
+// Cell colours for the tetris board, looked up by the board's cell byte.
+//
+// There is one 256 entry table per render state.  Cells marked as
+// shimmering in the animating state (empty cells in the built in themes)
+// take a colour from a small table chosen by a xorshift generator that
+// is reseeded from the frame number, so one frame always shimmers the
+// same way.
+class TetrisPalette
+{
+public:
+	using color = fc::fc::colornames;
+
+	enum state
+	{
+		normal,
+		animating,
+		ghost,
+		state_count
+	};
+
+	color get(state s, int cell)
+	{
+		auto c = cell & 0xff;
+
+		if (s == animating && shimmering[c])
+			return shimmer[next() % shimmer.size()];
+
+		return table[s][c];
+	}
+
+	void beginFrame(std::uint32_t frame)
+	{
+		// any non-zero seed will do for xorshift
+		rng = frame * 2654435761u | 1;
+	}
+
+	static TetrisPalette classic()
+	{
+		TetrisPalette p;
+
+		p.fill(fc::fc::Black, fc::fc::Grey30);
+		p.shimmer = {
+			fc::fc::Grey100,
+			fc::fc::Grey93,
+			fc::fc::Grey89,
+			fc::fc::Grey85,
+			fc::fc::Grey84,
+			fc::fc::Grey93,
+			fc::fc::Grey89,
+			fc::fc::Grey85
+		};
+
+		p.setPieces({ fc::fc::Purple, fc::fc::Red, fc::fc::Blue,
+		              fc::fc::Orange1, fc::fc::DarkSeaGreen1,
+		              fc::fc::Yellow, fc::fc::Cyan });
+		p.set(game::engine::garbage_cell, fc::fc::Grey50);
+
+		p.setFlash({ fc::fc::Black, fc::fc::PaleVioletRed1,
+		             fc::fc::LightRed, fc::fc::MediumVioletRed,
+		             fc::fc::Red, fc::fc::Red1, fc::fc::Red2, fc::fc::Red3,
+		             fc::fc::DarkRed, fc::fc::DarkRed2 });
+
+		return p;
+	}
+
+	// Only the 16 base colours, for terminals without 256 colour support
+	// or links where every colour change counts.
+	static TetrisPalette basic()
+	{
+		TetrisPalette p;
+
+		p.fill(fc::fc::Black, fc::fc::DarkGray);
+		p.shimmer.fill(fc::fc::LightGray);
+
+		p.setPieces({ fc::fc::Magenta, fc::fc::Red, fc::fc::Blue,
+		              fc::fc::Brown, fc::fc::Green,
+		              fc::fc::Yellow, fc::fc::Cyan });
+		p.set(game::engine::garbage_cell, fc::fc::LightGray);
+
+		p.setFlash({ fc::fc::Black, fc::fc::LightRed, fc::fc::LightRed,
+		             fc::fc::LightRed, fc::fc::Red, fc::fc::Red, fc::fc::Red,
+		             fc::fc::Red, fc::fc::Red, fc::fc::Red });
+
+		return p;
+	}
+
+private:
+	std::array<std::array<color, 256>, state_count> table{};
+	std::bitset<256> shimmering;
+	std::array<color, 8> shimmer{};
+	std::uint32_t rng{1};
+
+	std::uint32_t next()
+	{
+		rng ^= rng << 13;
+		rng ^= rng >> 17;
+		rng ^= rng << 5;
+		return rng;
+	}
+
+	// Empty and unknown cells: background colour, shimmering while
+	// animating, and every ghost cell in the ghost colour.
+	void fill(color background, color ghost_color)
+	{
+		table[normal].fill(background);
+		table[animating].fill(background);
+		table[ghost].fill(ghost_color);
+		shimmering.set();
+	}
+
+	void set(int cell, color c)
+	{
+		table[normal][cell] = c;
+		table[animating][cell] = c;
+		shimmering.reset(cell);
+	}
+
+	// Piece colours in t, s, z, l, j, o, i order
+	void setPieces(std::array<color, 7> const& c)
+	{
+		const char ids[] = { 't', 's', 'z', 'l', 'j', 'o', 'i' };
+
+		for(std::size_t i = 0; i < c.size(); ++i)
+			set(ids[i], c[i]);
+	}
+
+	// Colours of the line clear effect cells '0' to '9'
+	void setFlash(std::array<color, 10> const& c)
+	{
+		for(std::size_t i = 0; i < c.size(); ++i)
+			set('0' + i, c[i]);
+	}
+};
+
+#endif // TETRIS_PALETTE_H
@@ -0,0 +1,181 @@
+#include <iostream>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dataset.h"
+#include "perf_counters.h"
+#include "snapshot.h"
+#include "tetris_engine.h"
+
+// Headless player: replays moves read from stdin against one of the
+// test boards, one move per line ("a" left, "d" right, "r" rotate,
+// anything else just lets the piece fall), printing the board after
+// every tick.
+//
+//   tetris_replay [--board NAME|FILE] [--save FILE] [--export FILE]
+//                 [--quiet] [--perf] [--json]
+//
+// --board takes a fixture name (tc1..tc6 in fixtures/), a board file or
+// a .snap snapshot (see snapshot.h) to resume; --save writes a snapshot
+// of the game at end of input, --export every move and tick as a
+// training sample (see dataset.h).
+//
+// --perf counts hardware events for the input and update regions (see
+// perf_counters.h), --json prints the totals as JSON at end of input
+// and implies --quiet.
+
+namespace {
+
+struct region
+{
+	const char *name;
+	std::uint64_t count{0};
+	std::chrono::nanoseconds time{0};
+	perf::sample counters{};
+
+	template <typename F>
+	void measure(F&& f, perf::group const *pmu)
+	{
+		perf::sample before;
+		if (pmu)
+			before = pmu->read();
+
+		auto start = std::chrono::steady_clock::now();
+
+		f();
+
+		time += std::chrono::steady_clock::now() - start;
+
+		if (pmu)
+			counters += pmu->read() - before;
+
+		++count;
+	}
+};
+
+}
+
+int main(int argc, char **argv)
+{
+	std::string board = "tc6";
+	std::string save;
+	std::string samples;
+	bool quiet = false;
+	bool use_perf = false;
+	bool json = false;
+
+	for(int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+
+		if (arg == "--board" && i + 1 < argc)
+			board = argv[++i];
+		else if (arg == "--save" && i + 1 < argc)
+			save = argv[++i];
+		else if (arg == "--export" && i + 1 < argc)
+			samples = argv[++i];
+		else if (arg == "--quiet")
+			quiet = true;
+		else if (arg == "--perf")
+			use_perf = true;
+		else if (arg == "--json")
+			json = quiet = true;
+		else {
+			std::cerr << "usage: " << argv[0]
+			          << " [--board NAME|FILE] [--save FILE] [--export FILE]"
+			          << " [--quiet] [--perf] [--json]\n";
+			return 2;
+		}
+	}
+
+	game::engine eng{8, 20};
+
+	if (!game::load_board_file(board, eng)) {
+		std::cerr << "cannot load board " << board << "\n";
+		return 2;
+	}
+
+	std::unique_ptr<game::dataset_writer> dataset;
+	if (!samples.empty())
+		dataset = std::make_unique<game::dataset_writer>(samples, eng.width, eng.height);
+
+	perf::group pmu;
+	if (use_perf && !pmu.ok())
+		std::cerr << "warning: no hardware counters available\n";
+
+	perf::group const *counters = use_perf && pmu.ok() ? &pmu : nullptr;
+
+	region input{"input"};
+	region update{"update"};
+
+	if (!quiet)
+		std::cout << eng << "\n";
+
+	std::string line;
+	while(std::getline(std::cin, line)) {
+		auto act = line == "a" ? game::action::left
+		         : line == "d" ? game::action::right
+		         : line == "r" ? game::action::rotate
+		         : game::action::none;
+		int before = eng.score;
+
+		if (dataset)
+			dataset->observe(eng);
+
+		input.measure([&] {
+			if (line == "a")
+				eng.move_left();
+			else if (line == "d")
+				eng.move_right();
+			else if (line == "r")
+				eng.rotate();
+		}, counters);
+
+		update.measure([&] { eng.update(); }, counters);
+
+		if (dataset)
+			dataset->commit(act, eng.score - before);
+
+		if (!quiet) {
+			eng.print(std::cout);
+			std::cout << "\n\n";
+		}
+	}
+
+	if (!save.empty()) {
+		auto snap = game::take_snapshot(eng);
+		if (!game::write_snapshots(save, &snap, 1))
+			std::cerr << "cannot write " << save << "\n";
+	}
+
+	if (dataset) {
+		dataset->close();
+		if (!dataset->ok())
+			std::cerr << "cannot write " << samples << "\n";
+	}
+
+	if (json) {
+		std::cout << "{\n  \"board\": \"" << board << "\""
+		          << ",\n  \"score\": " << eng.score
+		          << ",\n  \"regions\": [";
+
+		const char *sep = "\n";
+		for(auto r : {&input, &update}) {
+			std::cout << sep << "    {\"name\": \"" << r->name << "\""
+			          << ", \"count\": " << r->count
+			          << ", \"ns\": " << r->time.count()
+			          << ", \"perf\": ";
+			if (counters)
+				pmu.write_json(std::cout, r->counters);
+			else
+				std::cout << "null";
+			std::cout << "}";
+			sep = ",\n";
+		}
+
+		std::cout << "\n  ]\n}\n";
+	}
+
+	return 0;
+}
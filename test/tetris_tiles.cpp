@@ -0,0 +1,323 @@
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <final/final.h>
+
+#include "asciicast.h"
+#include "autoplay.h"
+#include "battle.h"
+#include "board_painter.h"
+#include "tetris_engine.h"
+#include "worker_pool.h"
+
+namespace fc = finalcut;
+
+// Spectator view: many autoplayed games tiled in one window.
+//
+//   tetris_tiles [--boards N] [--fps N] [--steps N] [--threads N]
+//                [--width N] [--height N] [--half-block] [--battle [--seed N]]
+//                [--record FILE]
+//
+// Every frame the engines are stepped on a pool of worker threads,
+// then only the tiles whose board changed are repainted.  With --battle
+// the boards play one versus game against each other instead (see
+// battle.h), --steps ticks per frame, and a new one starts with the
+// next seed a while after it is decided.  Keys: '+'/'-' frame rate,
+// 'h' half-block mode, 'q' quit.  --record writes the session to FILE
+// in asciicast format (see asciicast.h).  Boards are at most 30 by 32,
+// the most the bot's bitboards hold.
+
+class BoardTile : public fc::FWidget
+{
+public:
+	game::engine engine;
+	game::autoplayer player;
+	BoardPainter painter{*this};
+
+	// the seat of a battle shown instead of the own engine
+	game::battle::player *seat{nullptr};
+	bool winner{false};
+
+	int number;
+	int games{1};
+	std::uint64_t drawn_version{~0ull};
+
+	BoardTile(fc::FWidget *parent, int n, std::size_t w, std::size_t h)
+		: fc::FWidget(parent)
+		, engine(w, h, n + 1)
+		, number(n)
+	{
+		painter.scale_x = 1;
+		painter.scale_y = 1;
+
+		engine.reset();
+	}
+
+	std::size_t tileWidth() const
+	{
+		return painter.columns(engine.width) + 2;
+	}
+
+	std::size_t tileHeight() const
+	{
+		return painter.rows(engine.height) + 2;
+	}
+
+	game::engine& shown()
+	{
+		return seat ? seat->eng : engine;
+	}
+
+	bool changed()
+	{
+		return shown().version != drawn_version;
+	}
+
+	void step(int steps)
+	{
+		for(int i = 0; i < steps; ++i) {
+			if (engine.game_over) {
+				engine.restart();
+				++games;
+			}
+
+			player.step(engine);
+		}
+	}
+
+	void draw() override
+	{
+		auto& eng = shown();
+		painter.drawBoard(eng, eng.board, false, 2, 2);
+
+		setColor(winner ? fc::fc::Yellow : fc::fc::White, fc::fc::Grey0);
+		drawBorder();
+
+		print() << fc::FPoint(2, 1) << "#" << number << " " << eng.score;
+		if (seat)
+			print() << (winner ? " WIN" : seat->died_at >= 0 ? " out" : "")
+			        << " +" << seat->received;
+
+		drawn_version = eng.version;
+	}
+};
+
+class TilesWindow : public fc::FWindow
+{
+public:
+	std::vector<std::unique_ptr<BoardTile>> tiles;
+	worker_pool workers;
+
+	std::unique_ptr<game::battle> versus;
+	game::battle_options versus_options;
+	int decided_frames{0};
+
+	int fps;
+	int steps;
+	int timer_id{0};
+
+	TilesWindow(fc::FWidget& parent, int boards, std::size_t w, std::size_t h,
+	            int fps_, int steps_, std::size_t threads)
+		: fc::FWindow(&parent)
+		, workers(threads)
+		, fps(fps_)
+		, steps(steps_)
+	{
+		for(int i = 0; i < boards; ++i)
+			tiles.push_back(std::make_unique<BoardTile>(this, i, w, h));
+
+		layout();
+
+		timer_id = addTimer(1000 / fps);
+	}
+
+	void layout()
+	{
+		std::size_t columns = std::ceil(std::sqrt(tiles.size()));
+		std::size_t rows = (tiles.size() + columns - 1) / columns;
+
+		auto tw = tiles[0]->tileWidth();
+		auto th = tiles[0]->tileHeight();
+
+		getRootWidget()->clearArea();
+
+		setGeometry({1, 1, columns*tw, rows*th});
+
+		for(std::size_t i = 0; i < tiles.size(); ++i) {
+			int x = (i % columns) * tw + 1;
+			int y = (i / columns) * th + 1;
+			tiles[i]->setGeometry({x, y, tw, th});
+			tiles[i]->drawn_version = ~0ull;
+		}
+	}
+
+	void onKeyPress(fc::FKeyEvent *ev) override
+	{
+		switch(ev->key()) {
+		case fc::fc::Fkey_escape:
+		case 'q':
+			close();
+			break;
+
+		case '+':
+			fps = std::min(fps * 2, 1000);
+			delTimer(timer_id);
+			timer_id = addTimer(1000 / fps);
+			break;
+
+		case '-':
+			fps = std::max(fps / 2, 1);
+			delTimer(timer_id);
+			timer_id = addTimer(1000 / fps);
+			break;
+
+		case 'h':
+			for(auto& t : tiles)
+				t->painter.half_block = !t->painter.half_block;
+			layout();
+			redraw();
+			break;
+
+		default:
+			fc::FWindow::onKeyPress(ev);
+		}
+	}
+
+	// Let the tiles play one versus game from now on
+	void startBattle(game::battle_options const& o)
+	{
+		versus_options = o;
+		versus_options.players = tiles.size();
+		versus = std::make_unique<game::battle>(versus_options);
+		decided_frames = 0;
+
+		for(std::size_t i = 0; i < tiles.size(); ++i) {
+			tiles[i]->seat = &(*versus)[i];
+			tiles[i]->winner = false;
+			tiles[i]->drawn_version = ~0ull;
+		}
+	}
+
+	void stepBattle()
+	{
+		if (!versus->over()) {
+			for(int i = 0; i < steps && !versus->over(); ++i)
+				versus->step();
+
+			if (versus->over()) {
+				auto w = versus->winner();
+				if (w >= 0) {
+					tiles[w]->winner = true;
+					tiles[w]->drawn_version = ~0ull;
+				}
+			}
+		} else if (++decided_frames > 2 * fps) {
+			// about two seconds to look at the result
+			++versus_options.seed;
+			startBattle(versus_options);
+		}
+
+		for(auto& t : tiles)
+			if (t->changed())
+				t->redraw();
+	}
+
+	void onTimer(fc::FTimerEvent *) override
+	{
+		if (versus) {
+			stepBattle();
+			return;
+		}
+
+		// worker i steps tiles i, i + n, i + 2n, ...
+		workers.run([this](std::size_t worker) {
+			for(std::size_t i = worker; i < tiles.size(); i += workers.size())
+				tiles[i]->step(steps);
+		});
+
+		for(auto& t : tiles)
+			if (t->changed())
+				t->redraw();
+	}
+
+	void draw() override
+	{
+		setColor(fc::fc::White, fc::fc::Black);
+		clearArea();
+	}
+};
+
+int main(int argc, char **argv)
+{
+	int boards = 16;
+	int fps = 10;
+	int steps = 1;
+	std::size_t threads = std::thread::hardware_concurrency();
+	std::size_t width = 15, height = 19;
+	bool half_block = false;
+	bool battle = false;
+	game::battle_options versus;
+
+	auto session = asciicast::from_args(argc, argv);
+	if (session && !session->ok()) {
+		std::cerr << "cannot record to " << session->path() << "\n";
+		return 2;
+	}
+
+	int out = 1;
+	for(int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool more = i + 1 < argc;
+
+		if (arg == "--boards" && more)
+			boards = std::max(std::atoi(argv[++i]), 1);
+		else if (arg == "--fps" && more)
+			fps = std::max(std::atoi(argv[++i]), 1);
+		else if (arg == "--steps" && more)
+			steps = std::max(std::atoi(argv[++i]), 1);
+		else if (arg == "--threads" && more)
+			threads = std::max(std::atoi(argv[++i]), 1);
+		else if (arg == "--width" && more)
+			width = std::clamp(std::atoi(argv[++i]), 4, int(game::bitboard::max_width));
+		else if (arg == "--height" && more)
+			height = std::clamp(std::atoi(argv[++i]), 6, int(game::bitboard::max_height));
+		else if (arg == "--half-block")
+			half_block = true;
+		else if (arg == "--battle")
+			battle = true;
+		else if (arg == "--seed" && more)
+			versus.seed = std::strtoul(argv[++i], nullptr, 10);
+		else
+			argv[out++] = argv[i];
+	}
+	argc = out;
+
+	fc::FApplication app{argc, argv};
+	TilesWindow tiles{app, std::max(boards, battle ? 2 : 1), width, height,
+	                  fps, steps, threads};
+
+	if (battle) {
+		versus.width = width;
+		versus.height = height;
+		tiles.startBattle(versus);
+	}
+
+	if (half_block) {
+		for(auto& t : tiles.tiles)
+			t->painter.half_block = true;
+		tiles.layout();
+	}
+
+	app.setMainWidget(&tiles);
+
+	tiles.show();
+
+	return app.exec();
+}
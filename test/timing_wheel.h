@@ -0,0 +1,230 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+namespace effects {
+
+// Hierarchical timing wheel with millisecond ticks.  Four levels of 64
+// slots, each level 64 times coarser than the one below, cover about
+// four and a half hours; a timer is kept in an intrusive list in the
+// slot of the level whose span covers its distance, and moves down a
+// level whenever the level below comes round to that slot.  Scheduling
+// and cancelling are O(1) whatever the number of timers, and advance()
+// jumps over runs of empty slots using one bit per slot.
+//
+// The wheel has no thread or clock of its own: its owner calls
+// advance() from one timer and the actions run right there.
+class timing_wheel
+{
+public:
+	using clock = std::chrono::steady_clock;
+
+	static constexpr int slot_bits = 6;
+	static constexpr std::size_t slots = std::size_t(1) << slot_bits;
+	static constexpr std::size_t levels = 4;
+
+	// A timer may be scheduled again, also from its own action; it is
+	// cancelled when destroyed, so it must not outlive its wheel while
+	// pending.
+	class timer
+	{
+	public:
+		std::function<void()> action;
+
+		timer() = default;
+
+		explicit timer(std::function<void()> f)
+			: action(std::move(f))
+		{}
+
+		timer(timer const&) = delete;
+		timer& operator=(timer const&) = delete;
+
+		~timer()
+		{
+			cancel();
+		}
+
+		bool pending() const
+		{
+			return prev != nullptr;
+		}
+
+		void cancel()
+		{
+			if (prev)
+				owner->unlink(*this);
+		}
+
+	private:
+		friend class timing_wheel;
+
+		timing_wheel *owner{nullptr};
+		timer *next{nullptr};
+		timer **prev{nullptr};
+		std::uint64_t due{0};
+		std::uint8_t level{0}, slot{0};
+	};
+
+	explicit timing_wheel(clock::time_point start = clock::now())
+		: origin(start)
+	{}
+
+	timing_wheel(timing_wheel const&) = delete;
+	timing_wheel& operator=(timing_wheel const&) = delete;
+
+	// Fire t in the first advance() reaching at, and not in the one
+	// running now
+	void schedule(timer& t, clock::time_point at)
+	{
+		t.cancel();
+
+		auto d = at - origin;
+		auto ms = std::chrono::ceil<std::chrono::milliseconds>(d).count();
+
+		t.owner = this;
+		t.due = std::max<std::int64_t>(ms, std::int64_t(current) + 1);
+		insert(t);
+	}
+
+	// Fire every timer due by now, in order of their deadlines to the
+	// millisecond
+	void advance(clock::time_point now)
+	{
+		auto target = ticks(now);
+
+		while(current < target) {
+			auto pos = current & (slots - 1);
+			auto later = pos == slots - 1 ? 0 : bits[0] & (~0ull << (pos + 1));
+
+			// nothing more on level 0 this round, skip to its end
+			if (!later) {
+				auto end = current | (slots - 1);
+				if (end >= target) {
+					current = target;
+					break;
+				}
+				current = end;
+			}
+
+			++current;
+			if ((current & (slots - 1)) == 0)
+				cascade(1);
+			fire(current & (slots - 1));
+		}
+	}
+
+	// Timers pending
+	std::size_t size() const
+	{
+		return count;
+	}
+
+	// Time the wheel has advanced to
+	clock::time_point now() const
+	{
+		return origin + std::chrono::milliseconds(current);
+	}
+
+private:
+	clock::time_point origin;
+	std::uint64_t current{0};
+	std::size_t count{0};
+
+	timer *heads[levels][slots]{};
+	std::uint64_t bits[levels]{};
+
+	std::uint64_t ticks(clock::time_point t) const
+	{
+		if (t <= origin)
+			return 0;
+		return std::chrono::duration_cast<std::chrono::milliseconds>(t - origin).count();
+	}
+
+	void insert(timer& t)
+	{
+		// the lowest level where due is in the round current is in;
+		// beyond the top level it waits there and is looked at again
+		// each time the top level comes round
+		std::size_t l = 0;
+		while(l + 1 < levels
+		      && (t.due >> (slot_bits * (l + 1))) != (current >> (slot_bits * (l + 1))))
+			++l;
+
+		auto s = (t.due >> (slot_bits * l)) & (slots - 1);
+		auto& head = heads[l][s];
+
+		t.level = l;
+		t.slot = s;
+		t.next = head;
+		t.prev = &head;
+		if (head)
+			head->prev = &t.next;
+		head = &t;
+
+		bits[l] |= 1ull << s;
+		++count;
+	}
+
+	void unlink(timer& t)
+	{
+		*t.prev = t.next;
+		if (t.next)
+			t.next->prev = t.prev;
+		t.next = nullptr;
+		t.prev = nullptr;
+
+		if (!heads[t.level][t.slot])
+			bits[t.level] &= ~(1ull << t.slot);
+		--count;
+	}
+
+	// Take a slot's list out of the wheel.  Its timers still link to
+	// the local head, so one may be cancelled while the list is worked
+	// through.
+	template <typename F>
+	void take(std::size_t l, std::size_t s, F&& f)
+	{
+		timer *list = std::exchange(heads[l][s], nullptr);
+		bits[l] &= ~(1ull << s);
+		if (list)
+			list->prev = &list;
+
+		// unlink() leaves the bit alone when f put a timer back into
+		// the same slot
+		while(auto *t = list) {
+			unlink(*t);
+			f(*t);
+		}
+	}
+
+	// Move the slot of level l that current has come round to down
+	void cascade(std::size_t l)
+	{
+		auto s = (current >> (slot_bits * l)) & (slots - 1);
+		if (s == 0 && l + 1 < levels)
+			cascade(l + 1);
+
+		take(l, s, [this](timer& t) { insert(t); });
+	}
+
+	void fire(std::size_t s)
+	{
+		take(0, s, [this](timer& t) {
+			if (t.due > current)
+				insert(t);
+			else if (t.action)
+				t.action();
+		});
+	}
+};
+
+}
+
+#endif // TIMING_WHEEL_H
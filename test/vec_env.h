@@ -0,0 +1,213 @@
+#ifndef VEC_ENV_H
+#define VEC_ENV_H
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "snapshot.h"
+#include "tetris_engine.h"
+#include "worker_pool.h"
+
+namespace game {
+
+// Batched training interface over N engines, gym style.
+//
+// step() applies one action per environment and writes every board into
+// one caller-owned buffer of size() * observation_size() bytes, row-major
+// per environment, one byte per cell (0 for empty, otherwise the piece
+// id).  The per-environment results live in flat arrays indexed by
+// environment: reward, done, score, and the active and next piece.
+// Boards taller than engine::max_height rows are cut down to it, as the
+// engines are.
+//
+// The boards are also kept in one contiguous array in the observation
+// layout.  A step converts only the rows the engine marked in dirty_rows
+// into it, which a board_history would otherwise use, and then copies
+// each environment's block out whole.
+//
+// An environment whose game ends is restarted inside the same step; its
+// done flag is set for that step and the observation already shows the
+// new game.  With threads > 1 the environments are split across a
+// worker_pool.
+class vec_env
+{
+public:
+	std::vector<float> rewards;
+	std::vector<std::uint8_t> dones;
+	std::vector<std::int32_t> scores;
+	std::vector<std::uint32_t> episode_steps;
+
+	std::vector<std::uint8_t> active_ids;
+	std::vector<std::int16_t> active_x, active_y;
+	std::vector<std::uint8_t> next_ids;
+
+	vec_env(std::size_t n, std::size_t w = 10, std::size_t h = 20,
+	        std::uint32_t seed = 1, std::size_t threads = 1)
+		: rewards(n)
+		, dones(n)
+		, scores(n)
+		, episode_steps(n)
+		, active_ids(n)
+		, active_x(n)
+		, active_y(n)
+		, next_ids(n)
+		, width(w)
+		, height(std::min(h, engine::max_height))
+		, cells(n * w * height)
+	{
+		engines.reserve(n);
+		for(std::size_t i = 0; i < n; ++i) {
+			// seeds must be non-zero to get random pieces
+			std::uint32_t s = seed + i * 7919;
+			engines.emplace_back(w, h, s ? s : 1);
+			engines.back().reset();
+		}
+
+		if (threads > 1)
+			workers = std::make_unique<worker_pool>(threads);
+	}
+
+	std::size_t size() const
+	{
+		return engines.size();
+	}
+
+	std::size_t observation_size() const
+	{
+		return width * height;
+	}
+
+	// Code writing to the board directly sets the engine's dirty_rows,
+	// so that the next observation shows the change
+	engine& operator[](std::size_t i)
+	{
+		return engines[i];
+	}
+
+	// Start every environment over and write the first observations
+	void reset(std::uint8_t *obs)
+	{
+		for(std::size_t i = 0; i < engines.size(); ++i) {
+			engines[i].restart();
+			engines[i].update();
+			episode_steps[i] = 0;
+			record(i, 0, false, obs);
+		}
+	}
+
+	// Checkpoint every environment into one snapshot file
+	bool save(std::string const& path) const
+	{
+		std::vector<snapshot> snaps;
+		snaps.reserve(engines.size());
+		for(auto const& eng : engines)
+			snaps.push_back(take_snapshot(eng));
+
+		return write_snapshots(path, snaps.data(), snaps.size());
+	}
+
+	// Resume from a checkpoint of as many environments of the same size;
+	// the episode step counts start over.
+	bool load(std::string const& path)
+	{
+		snapshot_file file(path);
+		if (!file.ok() || file.size() != engines.size())
+			return false;
+
+		for(std::size_t i = 0; i < engines.size(); ++i)
+			if (file[i].width != width || file[i].height != height
+			    || !restore(file[i], engines[i]))
+				return false;
+
+		std::fill(episode_steps.begin(), episode_steps.end(), 0);
+
+		return true;
+	}
+
+	void step(action const *actions, std::uint8_t *obs)
+	{
+		if (!workers) {
+			step_range(0, engines.size(), actions, obs);
+			return;
+		}
+
+		// contiguous blocks, so threads do not share cache lines of the
+		// result arrays
+		workers->run([&](std::size_t worker) {
+			auto n = engines.size(), t = workers->size();
+			step_range(n * worker / t, n * (worker + 1) / t, actions, obs);
+		});
+	}
+
+private:
+	std::vector<engine> engines;
+	std::size_t width, height;
+
+	// every board, environment by environment, as in the observations
+	std::vector<std::uint8_t> cells;
+
+	std::unique_ptr<worker_pool> workers;
+
+	void step_range(std::size_t first, std::size_t last,
+	                action const *actions, std::uint8_t *obs)
+	{
+		for(std::size_t i = first; i < last; ++i) {
+			auto& eng = engines[i];
+			int before = eng.score;
+
+			eng.step(actions[i]);
+			++episode_steps[i];
+
+			float reward = eng.score - before;
+			bool done = eng.game_over;
+
+			if (done) {
+				eng.restart();
+				eng.update();
+				episode_steps[i] = 0;
+			}
+
+			record(i, reward, done, obs);
+		}
+	}
+
+	void record(std::size_t i, float reward, bool done, std::uint8_t *obs)
+	{
+		auto& eng = engines[i];
+
+		rewards[i] = reward;
+		dones[i] = done;
+		scores[i] = eng.score;
+		next_ids[i] = eng.next_piece->id;
+
+		if (eng.active_piece) {
+			active_ids[i] = eng.active_piece->id;
+			active_x[i] = eng.active_piece->orig_x;
+			active_y[i] = eng.active_piece->orig_y;
+		} else {
+			active_ids[i] = 0;
+			active_x[i] = active_y[i] = -1;
+		}
+
+		auto *board = cells.data() + i * observation_size();
+		for(std::size_t y = 0; y < height; ++y) {
+			if (!((eng.dirty_rows >> y) & 1))
+				continue;
+
+			auto const& row = eng.board[y];
+			auto *out = board + y * width;
+			for(std::size_t x = 0; x < width; ++x)
+				out[x] = row[x];
+		}
+		eng.dirty_rows = 0;
+
+		std::memcpy(obs + i * observation_size(), board, observation_size());
+	}
+};
+
+}
+
+#endif // VEC_ENV_H
@@ -0,0 +1,354 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <final/final.h>
+
+#include "proc_stats.h"
+
+namespace fc = finalcut;
+
+// How the finalcut widget tree scales with the number of widgets.  For
+// each count a dialog is filled with that many labels, grouped into
+// nested panels, and timed:
+//
+//   construct  creating the dialog with all its widgets
+//   show       its first show() and paint
+//   adjust     a setSize() of the dialog, which adjusts every child
+//   redraw     a full redraw() and terminal update
+//   update     a timer tick that changes a few labels and redraws them
+//
+// together with the resident memory the widgets took.
+//
+//   widget_bench [--counts N,...] [--depth N] [--fanout N] [--repeat N]
+//                [--ticks N] [--updates N] [--out FILE]
+//
+// --depth is the panel levels between the dialog and the labels (2 by
+// default), each panel holding --fanout children (10).  adjust and
+// redraw are repeated --repeat times (20), update runs for --ticks
+// timer ticks (50) changing --updates labels a tick (1% of them, at
+// least 1).  It needs a terminal like the other examples; the results go
+// to FILE (widget_bench.json) as JSON.
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+double since_us(clock::time_point t)
+{
+	return std::chrono::duration<double, std::micro>(clock::now() - t).count();
+}
+
+struct options
+{
+	std::vector<std::size_t> counts{10, 100, 1000, 10000};
+	int depth = 2;
+	std::size_t fanout = 10;
+	int repeat = 20;
+	int ticks = 50;
+	std::size_t updates = 0;
+	std::string out = "widget_bench.json";
+};
+
+struct result
+{
+	std::size_t labels{0}, widgets{0};
+	double construct_us{0}, show_us{0}, adjust_us{0}, redraw_us{0};
+	double update_us{0}, update_max_us{0};
+	long rss_kb{0};
+};
+
+// The dialog under test
+class LabelWall : public fc::FDialog
+{
+	// every panel after the one it is in; see ~LabelWall()
+	std::vector<std::unique_ptr<fc::FWidget>> panels;
+	std::vector<std::unique_ptr<fc::FLabel>> labels;
+
+	int timer{0};
+	int ticks_left{0};
+	std::size_t per_tick{1};
+	std::size_t next{0};
+	unsigned long generation{0};
+
+	double update_total{0}, update_max{0};
+	int update_ticks{0};
+
+public:
+	LabelWall(fc::FWidget& root, options const& o, std::size_t count)
+		: FDialog(&root)
+	{
+		setText("widget_bench");
+		setPos(fc::FPoint(1, 1));
+		setSize(fc::FSize(78, 22));
+		setResizeable();
+
+		// level[l] is the panel labels go into at depth l + 1
+		std::vector<fc::FWidget *> level(o.depth, nullptr);
+		std::size_t span = 1;
+		for(int l = 0; l < o.depth; ++l)
+			span *= o.fanout;
+
+		for(std::size_t i = 0; i < count; ++i) {
+			fc::FWidget *parent = this;
+			std::size_t group = span;
+
+			for(int l = 0; l < o.depth; ++l) {
+				if (i % group == 0) {
+					panels.push_back(std::make_unique<fc::FWidget>(parent));
+					panels.back()->setGeometry({1, 1}, {getClientWidth(), getClientHeight()});
+					level[l] = panels.back().get();
+				}
+				parent = level[l];
+				group /= o.fanout;
+			}
+
+			labels.push_back(std::make_unique<fc::FLabel>(parent));
+			auto& label = *labels.back();
+			label.setGeometry({1 + int(i % 9) * 8, 1 + int(i / 9 % 20)}, {7, 1});
+			label.setText(fc::FString(std::to_string(i)));
+		}
+	}
+
+	// A finalcut widget deletes its children with it, so children go
+	// first, each leaving its parent as it goes: the labels, then the
+	// panels deepest first, before any parent could delete them again
+	~LabelWall() override
+	{
+		labels.clear();
+		while(!panels.empty())
+			panels.pop_back();
+	}
+
+	std::size_t widgets() const
+	{
+		return panels.size() + labels.size();
+	}
+
+	// Change per_tick labels on each of ticks timer ticks ms apart
+	void startUpdates(int ticks, std::size_t labels_per_tick, int ms)
+	{
+		ticks_left = ticks;
+		per_tick = labels_per_tick;
+		timer = addTimer(ms);
+	}
+
+	bool updating() const
+	{
+		return timer != 0;
+	}
+
+	double updateMean() const
+	{
+		return update_ticks ? update_total / update_ticks : 0;
+	}
+
+	double updateMax() const
+	{
+		return update_max;
+	}
+
+	void onTimer(fc::FTimerEvent *ev) override
+	{
+		if (ev->getTimerId() != timer)
+			return;
+
+		auto t = clock::now();
+
+		++generation;
+		for(std::size_t k = 0; k < per_tick && !labels.empty(); ++k) {
+			auto& label = *labels[next++ % labels.size()];
+			fc::FString s;
+			s.sprintf("%lu", generation);
+			label.setText(s);
+			label.redraw();
+		}
+		updateTerminal();
+
+		auto us = since_us(t);
+		update_total += us;
+		update_max = std::max(update_max, us);
+		++update_ticks;
+
+		if (--ticks_left <= 0) {
+			delTimer(timer);
+			timer = 0;
+		}
+	}
+};
+
+// Runs the counts one after the other from its timer, so every dialog is
+// measured inside the event loop as a real one would be
+class Runner : public fc::FDialog
+{
+	fc::FWidget& root;
+	options opt;
+	std::size_t index{0};
+	std::unique_ptr<LabelWall> wall;
+	result current;
+	std::vector<result> results;
+	fc::FLabel status{this};
+
+public:
+	Runner(fc::FWidget& r, options o)
+		: FDialog(&r)
+		, root(r)
+		, opt(std::move(o))
+	{
+		setText("widget_bench");
+		setPos(fc::FPoint(1, 24));
+		setSize(fc::FSize(40, 3));
+		status.setGeometry({1, 1}, {38, 1});
+
+		addTimer(10);
+	}
+
+	void onTimer(fc::FTimerEvent *) override
+	{
+		if (wall && wall->updating())
+			return;
+
+		if (wall) {
+			current.update_us = wall->updateMean();
+			current.update_max_us = wall->updateMax();
+			results.push_back(current);
+			wall.reset();
+			++index;
+		}
+
+		if (index == opt.counts.size()) {
+			write();
+			close();
+			return;
+		}
+
+		measure(opt.counts[index]);
+	}
+
+private:
+	void measure(std::size_t count)
+	{
+		fc::FString s;
+		s.sprintf("%zu labels", count);
+		status.setText(s);
+		status.redraw();
+
+		current = result{};
+		current.labels = count;
+
+		auto rss = procstats::rss_kb();
+
+		auto t = clock::now();
+		wall = std::make_unique<LabelWall>(root, opt, count);
+		current.construct_us = since_us(t);
+		current.widgets = wall->widgets();
+
+		t = clock::now();
+		wall->show();
+		updateTerminal();
+		current.show_us = since_us(t);
+
+		t = clock::now();
+		for(int i = 0; i < opt.repeat; ++i)
+			wall->setSize(i % 2 ? fc::FSize(78, 22) : fc::FSize(70, 20));
+		current.adjust_us = since_us(t) / opt.repeat;
+
+		t = clock::now();
+		for(int i = 0; i < opt.repeat; ++i) {
+			wall->redraw();
+			updateTerminal();
+		}
+		current.redraw_us = since_us(t) / opt.repeat;
+
+		current.rss_kb = procstats::rss_kb() - rss;
+
+		auto updates = opt.updates ? opt.updates : std::max<std::size_t>(count / 100, 1);
+		wall->startUpdates(opt.ticks, updates, 10);
+	}
+
+	void write() const
+	{
+		std::ofstream f(opt.out);
+		f << "{\n  \"depth\": " << opt.depth
+		  << ",\n  \"fanout\": " << opt.fanout
+		  << ",\n  \"repeat\": " << opt.repeat
+		  << ",\n  \"ticks\": " << opt.ticks
+		  << ",\n  \"results\": [";
+
+		char const *sep = "\n";
+		for(auto const& r : results) {
+			double per = r.widgets ? 1024.0 * r.rss_kb / r.widgets : 0;
+			f << sep << "    {\"labels\": " << r.labels
+			  << ", \"widgets\": " << r.widgets
+			  << ", \"construct_us\": " << r.construct_us
+			  << ", \"show_us\": " << r.show_us
+			  << ", \"adjust_us\": " << r.adjust_us
+			  << ", \"redraw_us\": " << r.redraw_us
+			  << ", \"update_us\": " << r.update_us
+			  << ", \"update_max_us\": " << r.update_max_us
+			  << ", \"rss_kb\": " << r.rss_kb
+			  << ", \"bytes_per_widget\": " << per << "}";
+			sep = ",\n";
+		}
+
+		f << "\n  ]\n}\n";
+	}
+};
+
+std::vector<std::size_t> parse_counts(char const *list)
+{
+	std::vector<std::size_t> out;
+	for(char const *p = list; *p; ) {
+		char *end;
+		auto n = std::strtoul(p, &end, 10);
+		if (end == p)
+			break;
+		out.push_back(n);
+		p = *end == ',' ? end + 1 : end;
+	}
+	return out;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	options opt;
+
+	// take our options out of argv before finalcut sees it
+	int out = 1;
+	for(int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--counts") == 0 && i + 1 < argc)
+			opt.counts = parse_counts(argv[++i]);
+		else if (std::strcmp(argv[i], "--depth") == 0 && i + 1 < argc)
+			opt.depth = std::max(0, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--fanout") == 0 && i + 1 < argc)
+			opt.fanout = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+			opt.repeat = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--ticks") == 0 && i + 1 < argc)
+			opt.ticks = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--updates") == 0 && i + 1 < argc)
+			opt.updates = std::atol(argv[++i]);
+		else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+			opt.out = argv[++i];
+		else
+			argv[out++] = argv[i];
+	}
+	argc = out;
+
+	fc::FApplication app{argc, argv};
+	Runner runner{app, opt};
+	app.setMainWidget(&runner);
+
+	runner.show();
+
+	return app.exec();
+}
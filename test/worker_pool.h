@@ -0,0 +1,90 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads that run one job at a time in lockstep: run()
+// hands the same job to every worker, each called with its own index,
+// and returns once all of them are done.  Meant for stepping many
+// engines once per frame without starting threads every frame.
+class worker_pool
+{
+	std::vector<std::thread> threads;
+	std::mutex m;
+	std::condition_variable start_cv, done_cv;
+
+	std::function<void(std::size_t)> job;
+	std::uint64_t generation{0};
+	std::size_t remaining{0};
+	bool stopping{false};
+
+	void work(std::size_t index)
+	{
+		std::uint64_t seen = 0;
+
+		for(;;) {
+			std::unique_lock<std::mutex> lock(m);
+			start_cv.wait(lock, [&] { return stopping || generation != seen; });
+			if (stopping)
+				return;
+
+			seen = generation;
+			lock.unlock();
+
+			job(index);
+
+			lock.lock();
+			if (--remaining == 0)
+				done_cv.notify_one();
+		}
+	}
+
+public:
+	explicit worker_pool(std::size_t n)
+	{
+		if (n == 0)
+			n = 1;
+
+		for(std::size_t i = 0; i < n; ++i)
+			threads.emplace_back([this, i] { work(i); });
+	}
+
+	~worker_pool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m);
+			stopping = true;
+		}
+		start_cv.notify_all();
+
+		for(auto& t : threads)
+			t.join();
+	}
+
+	worker_pool(worker_pool const&) = delete;
+	worker_pool& operator=(worker_pool const&) = delete;
+
+	std::size_t size() const
+	{
+		return threads.size();
+	}
+
+	void run(std::function<void(std::size_t)> f)
+	{
+		std::unique_lock<std::mutex> lock(m);
+
+		job = std::move(f);
+		remaining = threads.size();
+		++generation;
+		start_cv.notify_all();
+
+		done_cv.wait(lock, [&] { return remaining == 0; });
+	}
+};
+
+#endif // WORKER_POOL_H